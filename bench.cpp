@@ -0,0 +1,128 @@
+#include <cstdlib>
+#include <ctime>
+#include <iostream>
+#include <utility>
+#include <vector>
+#include "compressedmatrix.h"
+#include "quantizedmatrix.h"
+#include "reordering.h"
+#include "sparsematrix.h"
+
+/**
+ * Time repeated matrix-vector multiplications, in seconds per product.
+ * @brief SpMV benchmark
+ * @param  m      Matrix providing multiply(x, y)
+ * @param  repeat Number of products
+ * @return Average seconds per product
+ */
+template <typename Q, typename M>
+double time_spmv(const M& m, int repeat) {
+  std::vector<Q> x(m.cols(), Q(1)), y(m.rows());
+
+  std::clock_t start = std::clock();
+
+  for (int r = 0; r < repeat; ++r) m.multiply(&x[0], &y[0]);
+
+  return static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC / repeat;
+}
+
+/**
+ * Time repeated products by k right-hand sides stored row major, in seconds
+ * per product.
+ * @brief SpMM benchmark
+ * @param  m      Compressed matrix
+ * @param  k      Number of right-hand sides
+ * @param  repeat Number of products
+ * @return Average seconds per product
+ */
+double time_spmm(const CompressedSparseMatrix<double>& m, size_t k,
+                 int repeat) {
+  std::vector<double> x(m.cols() * k, 1.0), y(m.rows() * k);
+
+  std::clock_t start = std::clock();
+
+  for (int r = 0; r < repeat; ++r) m.multiply_dense(&x[0], &y[0], k);
+
+  return static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC / repeat;
+}
+
+int main(int argc, const char* argv[]) {
+  size_t side = argc > 1 ? std::atoi(argv[1]) : 400;
+  size_t n = side * side;
+  int repeat = argc > 2 ? std::atoi(argv[2]) : 50;
+
+  // 5-point grid Laplacian with randomly scattered vertex numbers
+  std::vector<size_t> label(n);
+  for (size_t v = 0; v < n; ++v) label[v] = v;
+  std::srand(42);
+  for (size_t v = n - 1; v > 0; --v)
+    std::swap(label[v], label[std::rand() % (v + 1)]);
+
+  SparseMatrix<double> grid(n, n, 0.0);
+
+  // added in reverse order, so that each insertion happens at the head
+  for (size_t v = n; v-- > 0;) {
+    size_t r = v / side, c = v % side;
+
+    if (r + 1 < side) grid.add(v, v + side, -1.0);
+    if (c + 1 < side) grid.add(v, v + 1, -1.0);
+    grid.add(v, v, 4.0);
+    if (c > 0) grid.add(v, v - 1, -1.0);
+    if (r > 0) grid.add(v, v - side, -1.0);
+  }
+
+  SparseMatrix<double> scattered = grid.permute(label, label);
+
+  std::clock_t start = std::clock();
+  std::vector<size_t> p = reverse_cuthill_mckee(scattered);
+  double rcm = static_cast<double>(std::clock() - start) / CLOCKS_PER_SEC;
+
+  SparseMatrix<double> reordered = scattered.permute(p, p);
+
+  CompressedSparseMatrix<double> before(scattered);
+  CompressedSparseMatrix<double> after(reordered);
+
+  std::cout << "grid " << side << " x " << side << ", " << n << " rows, "
+            << scattered.size() << " elements" << std::endl;
+  std::cout << "RCM time:            " << rcm << " s" << std::endl;
+  std::cout << "bandwidth scattered: " << bandwidth(scattered) << std::endl;
+  std::cout << "bandwidth RCM:       " << bandwidth(reordered) << std::endl;
+  std::cout << "SpMV scattered:      " << time_spmv<double>(before, repeat)
+            << " s" << std::endl;
+  std::cout << "SpMV RCM:            " << time_spmv<double>(after, repeat)
+            << " s, " << after.bytes() << " bytes" << std::endl;
+
+  // 64 right-hand sides at once, against 64 matrix-vector products
+  std::cout << "SpMM RCM, 64 x:      " << time_spmm(after, 64, repeat / 10 + 1)
+            << " s, 64 SpMV: " << 64 * time_spmv<double>(after, repeat) << " s"
+            << std::endl;
+
+  // narrower values of the RCM matrix, products in float
+  CompressedSparseMatrix<float> single(reordered);
+  CompressedSparseMatrix<bfloat16> brain(reordered);
+  QuantizedSparseMatrix<> quantized(reordered);
+
+  std::cout << "SpMV RCM float:      " << time_spmv<float>(single, repeat)
+            << " s, " << single.bytes() << " bytes" << std::endl;
+  std::cout << "SpMV RCM bfloat16:   " << time_spmv<float>(brain, repeat)
+            << " s, " << brain.bytes() << " bytes" << std::endl;
+  std::cout << "SpMV RCM int8_t:     " << time_spmv<float>(quantized, repeat)
+            << " s, " << quantized.bytes() << " bytes" << std::endl;
+
+  // the RCM band also fits 16 bit column deltas
+  if (bandwidth(reordered) <= 32767) {
+    CompressedSparseMatrix<float, uint16_t> single16(reordered);
+    CompressedSparseMatrix<bfloat16, uint16_t> brain16(reordered);
+    QuantizedSparseMatrix<uint16_t> quantized16(reordered);
+
+    std::cout << "SpMV RCM float, 16:  " << time_spmv<float>(single16, repeat)
+              << " s, " << single16.bytes() << " bytes" << std::endl;
+    std::cout << "SpMV RCM bf16, 16:   " << time_spmv<float>(brain16, repeat)
+              << " s, " << brain16.bytes() << " bytes" << std::endl;
+    std::cout << "SpMV RCM int8_t, 16: "
+              << time_spmv<float>(quantized16, repeat) << " s, "
+              << quantized16.bytes() << " bytes" << std::endl;
+  }
+
+  return 0;
+}
@@ -1,4 +1,13 @@
 #include <string>
+#include <vector>
+#include "compressedmatrix.h"
+#include "quantizedmatrix.h"
+#include "reductions.h"
+#include "reordering.h"
+#include "semiring.h"
+#include "sharedmatrix.h"
+#include "solvers.h"
+#include "triangular.h"
 #include "sparsematrix.h"
 
 struct pair {
@@ -172,6 +181,135 @@ int main(int argc, const char* argv[]) {
   std::cout << "m7 (4 x 4):" << std::endl << m7;
   std::cout << std::endl << std::endl;
 
+  // CompressedSparseMatrix from m1, 16 bit column deltas
+  CompressedSparseMatrix<int, uint16_t> c1(m1);
+  std::cout << "c1 (5 x 5) compressed m1, " << c1.bytes() << " bytes:";
+  std::cout << std::endl << c1;
+  std::cout << std::endl << std::endl;
+
+  // CompressedSparseMatrix matrix-vector multiplication
+  std::vector<int> x1(5, 1);
+  std::vector<int> y1 = c1 * x1;
+  std::cout << "c1 * [1, 1, 1, 1, 1]: ";
+  for (size_t i = 0; i < y1.size(); ++i) std::cout << y1[i] << " ";
+  std::cout << std::endl << std::endl;
+
+  // CompressedSparseMatrix times a dense 5 x 2 row major matrix
+  std::vector<int> x2(10, 1), y2(10);
+  for (size_t j = 0; j < 5; ++j) x2[j * 2 + 1] = static_cast<int>(j);
+  c1.multiply_dense(&x2[0], &y2[0], 2);
+  std::cout << "c1 * [1, 1, 1, 1, 1; 0, 1, 2, 3, 4]^T: ";
+  for (size_t i = 0; i < 5; ++i)
+    std::cout << "[" << y2[i * 2] << ", " << y2[i * 2 + 1] << "] ";
+  std::cout << std::endl << std::endl;
+
+  // Conjugate Gradient and BiCGSTAB on a symmetric positive definite matrix
+  SparseMatrix<double> m8(0.0);
+  m8.add(0, 0, 4.0);
+  m8.add(0, 1, 1.0);
+  m8.add(1, 0, 1.0);
+  m8.add(1, 1, 3.0);
+  m8.add(1, 2, 1.0);
+  m8.add(2, 1, 1.0);
+  m8.add(2, 2, 2.0);
+  CompressedSparseMatrix<double> c8(m8);
+  std::vector<double> b8(3, 1.0), x8;
+  solver_result r8 = conjugate_gradient(m8, b8, x8);
+  std::cout << "m8 CG x: " << x8[0] << " " << x8[1] << " " << x8[2];
+  std::cout << " (" << r8.iterations << " iterations)";
+  std::cout << std::endl << std::endl;
+  x8.clear();
+  r8 = bicgstab(c8, b8, x8, ILU0Preconditioner<double>(c8));
+  std::cout << "m8 BiCGSTAB ILU(0) x: " << x8[0] << " " << x8[1] << " "
+            << x8[2] << " (" << r8.iterations << " iterations)";
+  std::cout << std::endl << std::endl;
+
+  // TriangularSolver on the lower triangle of m8, analysis reused
+  TriangularSolver<double> l8(m8, true);
+  std::vector<double> y8 = l8.solve(b8);
+  std::cout << "m8 lower solve x: " << y8[0] << " " << y8[1] << " " << y8[2];
+  std::cout << " (" << l8.levels() << " levels)";
+  std::cout << std::endl << std::endl;
+
+  // SparseMatrix permute with the Reverse Cuthill-McKee ordering
+  SparseMatrix<int> m9(5, 5, 0);
+  m9.add(0, 0, 1);
+  m9.add(0, 4, 2);
+  m9.add(4, 0, 2);
+  m9.add(1, 1, 3);
+  m9.add(1, 3, 4);
+  m9.add(3, 1, 4);
+  m9.add(2, 2, 5);
+  m9.add(4, 4, 6);
+  std::vector<size_t> p9 = reverse_cuthill_mckee(m9);
+  SparseMatrix<int> m10 = m9.permute(p9, p9);
+  std::cout << "m9 (5 x 5), bandwidth " << bandwidth(m9) << ":" << std::endl
+            << m9;
+  std::cout << std::endl << std::endl;
+  std::cout << "m10 (5 x 5) m9 RCM permuted, bandwidth " << bandwidth(m10)
+            << ":" << std::endl
+            << m10;
+  std::cout << std::endl << std::endl;
+
+  // Reductions, computed from the stored elements and D
+  std::vector<int> s1 = row_sums(m1);
+  std::vector<size_t> n1 = row_nnz(m1);
+  std::cout << "m1 row sums: ";
+  for (size_t i = 0; i < s1.size(); ++i) std::cout << s1[i] << " ";
+  std::cout << std::endl << std::endl;
+  std::cout << "m1 row nnz:  ";
+  for (size_t i = 0; i < n1.size(); ++i) std::cout << n1[i] << " ";
+  std::cout << std::endl << std::endl;
+  std::cout << "m1 sum: " << matrix_sum(m1) << ", min: " << min_value(m1)
+            << ", max: " << max_value(m1);
+  std::cout << std::endl << std::endl;
+  std::cout << "m3 Frobenius norm: " << frobenius_norm(m3);
+  std::cout << std::endl << std::endl;
+
+  // Reduced precision values: bfloat16 through the generic copy constructor,
+  // int8_t with a scale per row
+  SparseMatrix<bfloat16> m11(m8);
+  CompressedSparseMatrix<bfloat16, uint16_t> c11(m11);
+  QuantizedSparseMatrix<uint16_t> q8(m8);
+  std::cout << "c11 (3 x 3) bfloat16 m8, " << c11.bytes() << " bytes:";
+  std::cout << std::endl << c11;
+  std::cout << std::endl << std::endl;
+  std::cout << "q8 (3 x 3) int8_t m8, " << q8.bytes() << " bytes:";
+  std::cout << std::endl << q8;
+  std::cout << std::endl << std::endl;
+  std::vector<float> x11(3, 1.0f);
+  std::vector<float> y11 = q8 * x11;
+  std::cout << "q8 * [1, 1, 1]: " << y11[0] << " " << y11[1] << " " << y11[2];
+  std::cout << std::endl << std::endl;
+
+  // SharedSparseMatrix: publish m1 in shared memory, then attach to it
+  SharedSparseMatrix<int, uint16_t>::publish("/sparsematrix_m1", m1);
+  {
+    SharedSparseMatrix<int, uint16_t> s1("/sparsematrix_m1");
+    std::vector<int> y12 = s1.matrix() * x1;
+    std::cout << "s1 generation " << s1.generation() << " * [1, 1, 1, 1, 1]: ";
+    for (size_t i = 0; i < y12.size(); ++i) std::cout << y12[i] << " ";
+    std::cout << std::endl << std::endl;
+  }
+  SharedSparseMatrix<int, uint16_t>::remove("/sparsematrix_m1");
+
+  // Semiring products: shortest paths of two edges with (min, +), one
+  // breadth-first step with (or, and) masked by the complement of visited
+  SparseMatrix<double> m12(4, 4, 0.0);
+  m12.add(0, 1, 1.0);
+  m12.add(0, 2, 4.0);
+  m12.add(1, 2, 2.0);
+  m12.add(2, 3, 1.0);
+  SparseMatrix<double> m13 = m12.multiply(m12, min_plus<double>());
+  std::cout << "m13 (4 x 4) m12 (min, +) m12:" << std::endl << m13;
+  std::cout << std::endl << std::endl;
+  SparseMatrix<bool> f1(1, 4, false);
+  f1.add(0, 0, true);
+  f1.add(0, 1, true);
+  SparseMatrix<bool> f2 = f1.multiply(m12, or_and<bool>(), f1, true);
+  std::cout << "f2 (1 x 4) next frontier of f1 in m12:" << std::endl << f2;
+  std::cout << std::endl << std::endl;
+
   // Test out_of_range exception from get function
   try {
     std::cout << "m7(4, 2): " << m5(4, 2);
@@ -0,0 +1,709 @@
+#ifndef COMPRESSED_MATRIX_H_
+#define COMPRESSED_MATRIX_H_
+
+#include <algorithm>  // std::swap
+#include <cstddef>    // std::ptrdiff_t
+#include <cstdint>    // uint16_t, uint32_t, uint64_t
+#include <iostream>   // std::ostream
+#include <iterator>   // std::forward_iterator_tag
+#include <limits>     // std::numeric_limits
+#include <stdexcept>  // std::out_of_range, std::overflow_error
+#include <vector>     // std::vector
+
+#include "sparsematrix.h"
+
+/**
+ * Storage order of a dense matrix of right-hand sides.
+ * @brief Dense layout enum
+ */
+enum dense_layout {
+  dense_row_major,  ///< Element (j, c) of a cols x k matrix is at j * k + c
+  dense_col_major   ///< Element (j, c) of a cols x k matrix is at c * cols + j
+};
+
+/**
+ * Read-only compressed sparse row layout: stored elements are grouped by row,
+ * column indices are delta-encoded within each row using the index type I.
+ * The first column of a row is encoded relative to the diagonal, the others
+ * relative to the previous column: since only these gaps have to fit in I,
+ * narrow index types (uint16_t, uint32_t) can be used on large banded
+ * matrices too, e.g. after reverse_cuthill_mckee.
+ * @brief Compressed sparse matrix templated class
+ */
+template <typename T, typename I = uint32_t>
+class CompressedSparseMatrix {
+ public:
+  typedef typename SparseMatrix<T>::element element;  ///< Matrix element
+  typedef I index_type;                               ///< Column delta type
+
+ private:
+  /// Right-hand sides accumulated in registers by multiply_dense
+  static const size_t dense_width = 8;
+
+  /// Right-hand sides per cache tile of multiply_dense
+  static const size_t dense_tile = 64;
+
+  /// Rows of A decoded together by multiply_dense, reused by every tile
+  static const size_t dense_rows = 32;
+
+  size_t rows_;  ///< Matrix rows
+  size_t cols_;  ///< Matrix cols
+  T D_;          ///< Matrix default element's value
+
+  size_t size_;  ///< Matrix size, number of stored elements
+
+  const size_t* offsets_;  ///< Row i is stored in [offsets_[i], [i + 1])
+  const I* deltas_;        ///< Column deltas, first one relative to origin
+  const T* values_;        ///< Values of the stored elements
+
+  std::vector<size_t> offsets_data_;  ///< Owned offsets, empty for a view
+  std::vector<I> deltas_data_;        ///< Owned column deltas
+  std::vector<T> values_data_;        ///< Owned values
+
+  /**
+   * Point offsets_, deltas_ and values_ to the owned arrays.
+   * @brief Helper for constructors and assignment
+   */
+  void bind() {
+    size_ = values_data_.size();
+    offsets_ = &offsets_data_[0];
+    deltas_ = deltas_data_.empty() ? 0 : &deltas_data_[0];
+    values_ = values_data_.empty() ? 0 : &values_data_[0];
+  }
+
+  /**
+   * Get the column the first delta of row i is relative to: the diagonal,
+   * moved left by half the range of I so that the first column may lie on
+   * either side of it. The subtraction wraps around, and adding the first
+   * delta wraps back to the column.
+   * @brief Helper for column decoding
+   * @param  i Index of row, unsigned value
+   * @return Origin of row i
+   */
+  static size_t origin(size_t i) {
+    return i - (static_cast<size_t>(std::numeric_limits<I>::max()) / 2 + 1);
+  }
+
+  /**
+   * Append the column delta, checking that it fits in the index type.
+   * @brief Helper for the converting constructor
+   * @param delta Distance from the previous column of the row, or origin
+   * @throw overflow_error Delta is not representable with I
+   */
+  void push_delta(size_t delta) {
+    if (delta > static_cast<size_t>(std::numeric_limits<I>::max()))
+      throw std::overflow_error("column delta does not fit index type");
+
+    deltas_data_.push_back(static_cast<I>(delta));
+  }
+
+  /**
+   * Compute D * sum(x), the contribution of a row made only of D elements.
+   * @brief Helper for matrix-vector multiplication
+   * @param  x Input vector, cols() values of generic type Q
+   * @param  d Default element's value converted to Q
+   * @return Product of D and the sum of x
+   */
+  template <typename Q>
+  Q default_product(const Q* x, const Q& d) const {
+    Q sum = Q();
+
+    if (d == Q()) return sum;
+
+    for (size_t j = 0; j < cols_; ++j) sum += x[j];
+
+    return sum * d;
+  }
+
+  /**
+   * Compute row i times x as base + sum((a[i, j] - D) * x[j]) over the stored
+   * elements, decoding column indices as they are read. Even and odd elements
+   * are summed into two accumulators, so that consecutive additions do not
+   * wait on each other.
+   * @brief Helper for matrix-vector multiplication
+   * @param  i    Index of row, unsigned value
+   * @param  x    Input vector, cols() values of generic type Q
+   * @param  d    Default element's value converted to Q
+   * @param  base Product of D and the sum of x
+   * @return Element i of A * x
+   */
+  template <typename Q>
+  Q row_product(size_t i, const Q* x, const Q& d, const Q& base) const {
+    size_t k = offsets_[i], last = offsets_[i + 1], col = origin(i);
+    Q even = Q(), odd = Q();
+
+    for (; k + 1 < last; k += 2) {
+      col += deltas_[k];
+      even += (static_cast<Q>(values_[k]) - d) * x[col];
+      col += deltas_[k + 1];
+      odd += (static_cast<Q>(values_[k + 1]) - d) * x[col];
+    }
+
+    if (k < last) {
+      col += deltas_[k];
+      even += (static_cast<Q>(values_[k]) - d) * x[col];
+    }
+
+    return base + (even + odd);
+  }
+
+  /**
+   * Accumulate W right-hand sides of row i, from c, into local sums: each
+   * decoded element of the row is applied to all of them before moving on,
+   * so the sums stay in registers and y is written once.
+   * @brief Helper for matrix-dense matrix multiplication
+   * @param x      Input matrix, cols() * k values of generic type Q
+   * @param y      Output matrix, rows() * k values of generic type Q
+   * @param k      Number of right-hand sides
+   * @param layout Layout of x and y
+   * @param i      Index of row, unsigned value
+   * @param c      First right-hand side
+   * @param n      Number of stored elements of row i
+   * @param cols   Decoded columns of row i
+   * @param values Values of row i minus D, converted to Q
+   * @param base   D * sum(x[:, c]) of each right-hand side
+   */
+  template <size_t W, typename Q>
+  void dense_kernel(const Q* x, Q* y, size_t k, dense_layout layout, size_t i,
+                    size_t c, size_t n, const size_t* cols, const Q* values,
+                    const Q* base) const {
+    Q sum[W];
+
+    for (size_t v = 0; v < W; ++v) sum[v] = base[c + v];
+
+    if (layout == dense_row_major) {
+      for (size_t t = 0; t < n; ++t) {
+        const Q* row = x + cols[t] * k + c;
+        const Q a = values[t];
+
+        for (size_t v = 0; v < W; ++v) sum[v] += a * row[v];
+      }
+
+      for (size_t v = 0; v < W; ++v) y[i * k + c + v] = sum[v];
+    } else {
+      for (size_t t = 0; t < n; ++t) {
+        const Q* column = x + c * cols_ + cols[t];
+        const Q a = values[t];
+
+        for (size_t v = 0; v < W; ++v) sum[v] += a * column[v * cols_];
+      }
+
+      for (size_t v = 0; v < W; ++v) y[(c + v) * rows_ + i] = sum[v];
+    }
+  }
+
+ public:
+  /**
+   * Compress a SparseMatrix of generic type Q, visiting its list only once.
+   * @brief Converting constructor
+   * @param other SparseMatrix to compress
+   * @throw overflow_error A column delta is not representable with I
+   */
+  template <typename Q>
+  explicit CompressedSparseMatrix(const SparseMatrix<Q>& other)
+      : rows_(other.rows()),
+        cols_(other.cols()),
+        D_(static_cast<T>(other.D())),
+        offsets_data_(other.rows() + 1, 0) {
+#ifndef NDEBUG
+    std::cout << "CompressedSparseMatrix::CompressedSparseMatrix("
+                 "const SparseMatrix<Q>&)"
+              << std::endl;
+#endif
+
+    deltas_data_.reserve(other.size());
+    values_data_.reserve(other.size());
+
+    typename SparseMatrix<Q>::const_iterator it;
+    size_t row = 0, col = origin(0);
+
+    for (it = other.begin(); it != other.end(); ++it) {
+      // close the rows preceding the element's one
+      while (row < it->i) {
+        offsets_data_[++row] = values_data_.size();
+        col = origin(row);
+      }
+
+      push_delta(it->j - col);
+      values_data_.push_back(static_cast<T>(it->value));
+      col = it->j;
+    }
+
+    while (row < rows_) offsets_data_[++row] = values_data_.size();
+
+    bind();
+  }
+
+  /**
+   * Wrap arrays in the compressed layout without copying them, e.g. arrays
+   * mapped from shared memory. The arrays must outlive the matrix.
+   * @brief View constructor
+   * @param rows    Matrix rows
+   * @param cols    Matrix columns
+   * @param D       Matrix default element's value
+   * @param offsets rows + 1 offsets, offsets[rows] is the number of elements
+   * @param deltas  Column deltas of the elements
+   * @param values  Values of the elements
+   */
+  CompressedSparseMatrix(size_t rows, size_t cols, const T& D,
+                         const size_t* offsets, const I* deltas,
+                         const T* values)
+      : rows_(rows),
+        cols_(cols),
+        D_(D),
+        size_(offsets[rows]),
+        offsets_(offsets),
+        deltas_(deltas),
+        values_(values) {}
+
+  /**
+   * Create a compressed matrix from another instance: owned arrays are
+   * copied, views keep pointing to the same arrays.
+   * @brief Copy constructor
+   * @param other Other CompressedSparseMatrix to copy
+   */
+  CompressedSparseMatrix(const CompressedSparseMatrix& other)
+      : rows_(other.rows_),
+        cols_(other.cols_),
+        D_(other.D_),
+        size_(other.size_),
+        offsets_(other.offsets_),
+        deltas_(other.deltas_),
+        values_(other.values_),
+        offsets_data_(other.offsets_data_),
+        deltas_data_(other.deltas_data_),
+        values_data_(other.values_data_) {
+    if (!offsets_data_.empty()) bind();
+  }
+
+  /**
+   * Copy the data from another CompressedSparseMatrix instance.
+   * @brief Assignment operator
+   * @param  other Other CompressedSparseMatrix to copy
+   * @return Copied CompressedSparseMatrix
+   */
+  CompressedSparseMatrix& operator=(const CompressedSparseMatrix& other) {
+    if (this != &other) {
+      // swapped vectors keep their buffers, so the pointers stay valid
+      CompressedSparseMatrix tmp(other);
+      std::swap(rows_, tmp.rows_);
+      std::swap(cols_, tmp.cols_);
+      std::swap(D_, tmp.D_);
+      std::swap(size_, tmp.size_);
+      std::swap(offsets_, tmp.offsets_);
+      std::swap(deltas_, tmp.deltas_);
+      std::swap(values_, tmp.values_);
+      offsets_data_.swap(tmp.offsets_data_);
+      deltas_data_.swap(tmp.deltas_data_);
+      values_data_.swap(tmp.values_data_);
+    }
+
+    return *this;
+  }
+
+  /**
+   * Get matrix number of rows.
+   * @brief Rows getter
+   * @return Matrix rows
+   */
+  size_t rows() const { return rows_; }
+
+  /**
+   * Get matrix number of columns.
+   * @brief Columns getter
+   * @return Matrix columns
+   */
+  size_t cols() const { return cols_; }
+
+  /**
+   * Get the number of elements.
+   * @brief Size getter
+   * @return Matrix size
+   */
+  size_t size() const { return size_; }
+
+  /**
+   * Get the default element.
+   * @brief Default element getter
+   * @return Matrix default element's value
+   */
+  const T D() const { return D_; }
+
+  /**
+   * Get the number of bytes used by offsets, column deltas and values.
+   * @brief Memory footprint getter
+   * @return Bytes of storage
+   */
+  size_t bytes() const {
+    return (rows_ + 1) * sizeof(size_t) + size_ * (sizeof(I) + sizeof(T));
+  }
+
+  /**
+   * Get the rows() + 1 row offsets: row i is stored in
+   * [offsets()[i], offsets()[i + 1]) of deltas() and values().
+   * @brief Offsets getter
+   * @return Pointer to the offsets
+   */
+  const size_t* offsets() const { return offsets_; }
+
+  /**
+   * Get the size() column deltas, each relative to the previous column of
+   * its row. The first element of row i is relative to
+   * i - (max(I) / 2 + 1), wrapping around.
+   * @brief Column deltas getter
+   * @return Pointer to the column deltas
+   */
+  const I* deltas() const { return deltas_; }
+
+  /**
+   * Get the size() values, in row and column order.
+   * @brief Values getter
+   * @return Pointer to the values
+   */
+  const T* values() const { return values_; }
+
+  /**
+   * Decode the absolute column indices of the stored elements of row i.
+   * @brief Row columns decoder
+   * @param  i    Index of row, unsigned value
+   * @param  cols Output buffer, holding at least row_size(i) indices
+   * @return Number of decoded indices
+   */
+  size_t decode_row(size_t i, size_t* cols) const {
+    size_t col = origin(i), n = 0;
+
+    for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k, ++n)
+      cols[n] = (col += deltas_[k]);
+
+    return n;
+  }
+
+  /**
+   * Get the values of the stored elements of row i, in column order.
+   * @brief Row values getter
+   * @param  i Index of row, unsigned value
+   * @return Pointer to row_size(i) values
+   */
+  const T* row_values(size_t i) const {
+    return values_ + offsets_[i];
+  }
+
+  /**
+   * Get the number of stored elements of row i.
+   * @brief Row size getter
+   * @param  i Index of row, unsigned value
+   * @return Number of stored elements in row i
+   */
+  size_t row_size(size_t i) const { return offsets_[i + 1] - offsets_[i]; }
+
+  /**
+   * Return the element at the given coordinates, decoding row i.
+   * @brief Matrix get element
+   * @param  i Index of element relative to matrix rows, unsigned value
+   * @param  j Index of element relative to matrix columns, unsigned value
+   * @return Matrix element
+   * @throw  out_of_range Indices i or j are equal or greater than rows or cols
+   */
+  const T operator()(size_t i, size_t j) const {
+    if (i >= rows_ || j >= cols_)
+      throw std::out_of_range("i or j out of bounds");
+
+    size_t col = origin(i);
+
+    for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+      col += deltas_[k];
+
+      if (col == j) return values_[k];
+      if (col > j) break;
+    }
+
+    return D_;
+  }
+
+  /**
+   * Compute y = A * x, where unstored elements contribute D to each product.
+   * Rows are split among threads when built with OpenMP.
+   * @brief Matrix-vector multiplication
+   * @param x       Input vector, cols() values of generic type Q
+   * @param y       Output vector, rows() values of generic type Q
+   * @param threads Number of threads (default: 1)
+   */
+  template <typename Q>
+  void multiply(const Q* x, Q* y, int threads = 1) const {
+    const Q d = static_cast<Q>(D_);
+    const Q base = default_product(x, d);
+    const ptrdiff_t rows = static_cast<ptrdiff_t>(rows_);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+    for (ptrdiff_t i = 0; i < rows; ++i) y[i] = row_product(i, x, d, base);
+  }
+
+  /**
+   * Compute y = A * x and the dot product z * y in a single pass, so that
+   * iterative solvers do not read y back from memory.
+   * @brief Fused matrix-vector multiplication and dot product
+   * @param  x       Input vector, cols() values of generic type Q
+   * @param  y       Output vector, rows() values of generic type Q
+   * @param  z       Vector dotted with y, rows() values of generic type Q
+   * @param  threads Number of threads (default: 1)
+   * @return Dot product of z and y
+   */
+  template <typename Q>
+  Q multiply_dot(const Q* x, Q* y, const Q* z, int threads = 1) const {
+    const Q d = static_cast<Q>(D_);
+    const Q base = default_product(x, d);
+    const ptrdiff_t rows = static_cast<ptrdiff_t>(rows_);
+    Q dot = Q();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) \
+    schedule(static) reduction(+ : dot)
+#endif
+    for (ptrdiff_t i = 0; i < rows; ++i) {
+      y[i] = row_product(i, x, d, base);
+      dot += z[i] * y[i];
+    }
+
+    return dot;
+  }
+
+  /**
+   * Perform matrix-vector multiplication and return the result.
+   * @brief Matrix-vector multiplication operator
+   * @param  x Input vector, cols() values of generic type Q
+   * @return Vector of rows() values
+   * @throw  out_of_range x size differs from matrix columns
+   */
+  template <typename Q>
+  std::vector<Q> operator*(const std::vector<Q>& x) const {
+    if (x.size() != cols_) throw std::out_of_range("x.size() != m.cols()");
+
+    std::vector<Q> y(rows_);
+
+    if (rows_ > 0) multiply(x.empty() ? 0 : &x[0], &y[0]);
+
+    return y;
+  }
+
+  /**
+   * Compute Y = A * X, with X a dense cols() x k matrix and Y a dense
+   * rows() x k matrix in the same layout. Rows of A are processed in blocks
+   * of dense_rows: a block is decoded once into per-thread buffers, then
+   * applied to every cache tile of dense_tile right-hand sides, so that each
+   * stored element is read from memory once whatever k, and the decoded block
+   * stays in cache across tiles. Within a tile each row is applied to
+   * dense_width right-hand sides at a time, accumulated in registers. Row
+   * blocks are split among threads.
+   * @brief Matrix-dense matrix multiplication
+   * @param x       Input matrix, cols() * k values of generic type Q
+   * @param y       Output matrix, rows() * k values of generic type Q
+   * @param k       Number of right-hand sides
+   * @param layout  Layout of x and y (default: dense_row_major)
+   * @param threads Number of threads (default: 1)
+   */
+  template <typename Q>
+  void multiply_dense(const Q* x, Q* y, size_t k,
+                      dense_layout layout = dense_row_major,
+                      int threads = 1) const {
+    if (k == 0) return;
+
+    const Q d = static_cast<Q>(D_);
+    const ptrdiff_t blocks =
+        static_cast<ptrdiff_t>((rows_ + dense_rows - 1) / dense_rows);
+    std::vector<Q> base(k, Q());
+    size_t largest = 0;
+
+    // base[c] = D * sum(x[:, c])
+    if (d != Q()) {
+      for (size_t j = 0; j < cols_; ++j)
+        for (size_t c = 0; c < k; ++c)
+          base[c] +=
+              layout == dense_row_major ? x[j * k + c] : x[c * cols_ + j];
+
+      for (size_t c = 0; c < k; ++c) base[c] *= d;
+    }
+
+    for (ptrdiff_t b = 0; b < blocks; ++b) {
+      const size_t first = b * dense_rows;
+      const size_t last = std::min(first + dense_rows, rows_);
+
+      if (offsets_[last] - offsets_[first] > largest)
+        largest = offsets_[last] - offsets_[first];
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads) if (threads > 1)
+#endif
+    {
+      std::vector<size_t> cols(largest + 1);
+      std::vector<Q> values(largest + 1);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (ptrdiff_t b = 0; b < blocks; ++b) {
+        const size_t first = b * dense_rows;
+        const size_t last = std::min(first + dense_rows, rows_);
+        const size_t start = offsets_[first];
+
+        for (size_t i = first; i < last; ++i) {
+          const size_t at = offsets_[i] - start;
+          const size_t n = decode_row(i, &cols[at]);
+          const T* row = row_values(i);
+
+          for (size_t t = 0; t < n; ++t)
+            values[at + t] = static_cast<Q>(row[t]) - d;
+        }
+
+        for (size_t tile = 0; tile < k; tile += dense_tile) {
+          const size_t end = k - tile > dense_tile ? tile + dense_tile : k;
+
+          for (size_t i = first; i < last; ++i) {
+            const size_t at = offsets_[i] - start;
+            const size_t n = row_size(i);
+            size_t c = tile;
+
+            for (; c + dense_width <= end; c += dense_width)
+              dense_kernel<dense_width>(x, y, k, layout, i, c, n, &cols[at],
+                                        &values[at], &base[0]);
+
+            for (; c < end; ++c)
+              dense_kernel<1>(x, y, k, layout, i, c, n, &cols[at],
+                              &values[at], &base[0]);
+          }
+        }
+      }
+    }
+  }
+
+  // Iterators
+
+  /**
+   * Iterates through matrix's stored elements, decoding their coordinates.
+   * @brief Const iterator class
+   */
+  class const_iterator {
+   public:
+    /**
+     * Holds a decoded element, so that operator-> can return its address.
+     * @brief Element pointer proxy
+     */
+    struct pointer {
+      element e;  ///< Decoded element
+
+      const element* operator->() const { return &e; }
+    };
+
+    typedef std::forward_iterator_tag iterator_category;
+    typedef element value_type;
+    typedef ptrdiff_t difference_type;
+    typedef element reference;
+
+    const_iterator() : m(0), row(0), pos(0), col(0) {}
+
+    reference operator*() const { return element(row, col, m->values_[pos]); }
+
+    pointer operator->() const {
+      pointer p = {**this};
+
+      return p;
+    }
+
+    const_iterator operator++(int) {
+      const_iterator tmp(*this);
+      ++*this;
+
+      return tmp;
+    }
+
+    const_iterator& operator++() {
+      ++pos;
+      seek();
+
+      return *this;
+    }
+
+    bool operator==(const const_iterator& other) const {
+      return pos == other.pos;
+    }
+
+    bool operator!=(const const_iterator& other) const {
+      return pos != other.pos;
+    }
+
+   private:
+    const CompressedSparseMatrix* m;
+    size_t row;  ///< Row of the element at pos
+    size_t pos;  ///< Position of the element in deltas_ and values_
+    size_t col;  ///< Decoded column of the element at pos
+
+    friend class CompressedSparseMatrix;
+
+    const_iterator(const CompressedSparseMatrix* m, size_t pos)
+        : m(m), row(0), pos(pos), col(0) {
+      seek();
+    }
+
+    /**
+     * Move row to the one containing pos, then decode the column.
+     * @brief Iterator decoder
+     */
+    void seek() {
+      if (pos >= m->size_) return;
+
+      while (pos >= m->offsets_[row + 1]) ++row;
+
+      if (pos == m->offsets_[row]) col = origin(row);
+
+      col += m->deltas_[pos];
+    }
+  };
+
+  /**
+   * Return begin const iterator.
+   * @brief Const iterator begin
+   * @return Const iterator pointing to matrix's first element
+   */
+  const_iterator begin() const { return const_iterator(this, 0); }
+
+  /**
+   * Return end const iterator.
+   * @brief Const iterator end
+   * @return Const iterator pointing past matrix's last element
+   */
+  const_iterator end() const { return const_iterator(this, size()); }
+
+  /**
+   * Overloading of operator<<.
+   * @brief Matrix ostream operator
+   * @param  os Output stream
+   * @param  m  Matrix
+   * @return Updated output stream
+   */
+  friend std::ostream& operator<<(std::ostream& os,
+                                  const CompressedSparseMatrix& m) {
+    os << "[";
+
+    for (size_t i = 0; i < m.rows_; ++i) {
+      if (i > 0) os << ",\n ";
+
+      os << "[";
+
+      for (size_t j = 0; j < m.cols_; ++j) {
+        if (j > 0) os << ",\t";
+
+        os << m(i, j);
+      }
+
+      os << "]";
+    }
+
+    os << "]";
+
+    return os;
+  }
+};
+
+#endif
@@ -0,0 +1,411 @@
+#ifndef QUANTIZED_MATRIX_H_
+#define QUANTIZED_MATRIX_H_
+
+#include <cmath>      // std::isfinite
+#include <cstddef>    // std::ptrdiff_t
+#include <cstdint>    // int8_t, uint16_t, uint32_t
+#include <cstring>    // std::memcpy
+#include <iostream>   // std::ostream
+#include <limits>     // std::numeric_limits
+#include <stdexcept>  // std::overflow_error, std::domain_error
+#include <vector>     // std::vector
+
+#include "sparsematrix.h"
+
+/**
+ * Brain floating point: the upper 16 bits of a float (8 bit exponent, 7 bit
+ * mantissa). Converts to and from float, so SparseMatrix<bfloat16> can be
+ * copied from a SparseMatrix<float> or SparseMatrix<double>.
+ * @brief 16 bit brain floating point struct
+ */
+struct bfloat16 {
+  uint16_t bits;  ///< Sign, exponent and mantissa
+
+  bfloat16() : bits(0) {}
+
+  /**
+   * Round a float to the nearest bfloat16, ties to even.
+   * @brief bfloat16 converting constructor
+   * @param value Float value
+   */
+  bfloat16(float value) {
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+
+    // keep NaN a quiet NaN, rounding could turn it into infinity
+    if ((f & 0x7fffffff) > 0x7f800000) {
+      bits = static_cast<uint16_t>((f >> 16) | 0x0040);
+      return;
+    }
+
+    f += 0x7fff + ((f >> 16) & 1);
+    bits = static_cast<uint16_t>(f >> 16);
+  }
+
+  /**
+   * Widen to float, exactly.
+   * @brief bfloat16 float conversion
+   * @return Float value
+   */
+  operator float() const {
+    uint32_t f = static_cast<uint32_t>(bits) << 16;
+    float value;
+    std::memcpy(&value, &f, sizeof(value));
+
+    return value;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const bfloat16& v) {
+    return os << static_cast<float>(v);
+  }
+};
+
+/**
+ * IEEE 754 half precision (5 bit exponent, 10 bit mantissa). Converts to and
+ * from float, so SparseMatrix<float16> can be copied from a
+ * SparseMatrix<float> or SparseMatrix<double>.
+ * @brief 16 bit floating point struct
+ */
+struct float16 {
+  uint16_t bits;  ///< Sign, exponent and mantissa
+
+  float16() : bits(0) {}
+
+  /**
+   * Round a float to the nearest half, ties to even. Values too large become
+   * infinity, values too small become subnormal or zero.
+   * @brief float16 converting constructor
+   * @param value Float value
+   */
+  float16(float value) {
+    uint32_t f;
+    std::memcpy(&f, &value, sizeof(f));
+
+    uint32_t sign = (f >> 16) & 0x8000;
+    uint32_t abs = f & 0x7fffffff;
+    uint32_t h, rem, half;
+
+    if (abs >= 0x7f800000) {
+      // infinity or NaN
+      h = abs > 0x7f800000 ? 0x7e00 : 0x7c00;
+    } else if (abs >= 0x477ff000) {
+      // rounds above 65504
+      h = 0x7c00;
+    } else if (abs >= 0x38800000) {
+      // normal: rebias the exponent from 127 to 15
+      h = (abs - 0x38000000) >> 13;
+      rem = abs & 0x1fff;
+
+      if (rem > 0x1000 || (rem == 0x1000 && (h & 1))) ++h;
+    } else if (abs >= 0x33000000) {
+      // subnormal: shift the mantissa, implicit bit included
+      uint32_t shift = 126 - (abs >> 23);
+      uint32_t mantissa = (abs & 0x7fffff) | 0x800000;
+
+      h = mantissa >> shift;
+      rem = mantissa & ((1u << shift) - 1);
+      half = 1u << (shift - 1);
+
+      if (rem > half || (rem == half && (h & 1))) ++h;
+    } else {
+      h = 0;
+    }
+
+    bits = static_cast<uint16_t>(sign | h);
+  }
+
+  /**
+   * Widen to float, exactly.
+   * @brief float16 float conversion
+   * @return Float value
+   */
+  operator float() const {
+    uint32_t sign = static_cast<uint32_t>(bits & 0x8000) << 16;
+    uint32_t exponent = (bits >> 10) & 0x1f;
+    uint32_t mantissa = bits & 0x3ff;
+    uint32_t f;
+
+    if (exponent == 0) {
+      // subnormal, mantissa * 2^-24
+      float value = static_cast<float>(mantissa) / 16777216.0f;
+
+      return sign ? -value : value;
+    }
+
+    if (exponent == 31)
+      f = sign | 0x7f800000 | (mantissa << 13);
+    else
+      f = sign | ((exponent + 112) << 23) | (mantissa << 13);
+
+    float value;
+    std::memcpy(&value, &f, sizeof(value));
+
+    return value;
+  }
+
+  friend std::ostream& operator<<(std::ostream& os, const float16& v) {
+    return os << static_cast<float>(v);
+  }
+};
+
+/**
+ * Read-only compressed sparse row layout storing each value as an int8_t,
+ * multiplied by a float scale shared by its row: a[i, j] = scale[i] * q[i, j].
+ * Column indices are delta-encoded within each row using the index type I, as
+ * in CompressedSparseMatrix: the first one relative to the diagonal.
+ * @brief Quantized sparse matrix templated class
+ */
+template <typename I = uint32_t>
+class QuantizedSparseMatrix {
+ private:
+  size_t rows_;  ///< Matrix rows
+  size_t cols_;  ///< Matrix cols
+  float D_;      ///< Matrix default element's value
+
+  std::vector<size_t> offsets_;  ///< Row i is stored in [offsets_[i], [i + 1])
+  std::vector<I> deltas_;        ///< Column deltas, first relative to origin
+  std::vector<int8_t> values_;   ///< Quantized values, in [-127, 127]
+  std::vector<float> scales_;    ///< Scale of each row
+
+  /**
+   * Get the column the first delta of row i is relative to, as in
+   * CompressedSparseMatrix: the diagonal moved left by half the range of I,
+   * wrapping around.
+   * @brief Helper for column decoding
+   * @param  i Index of row, unsigned value
+   * @return Origin of row i
+   */
+  static size_t origin(size_t i) {
+    return i - (static_cast<size_t>(std::numeric_limits<I>::max()) / 2 + 1);
+  }
+
+  /**
+   * Quantize the values of a row with the scale max(|value|) / 127.
+   * @brief Helper for the converting constructor
+   * @param row Values of the stored elements of the row
+   * @return Scale of the row
+   * @throw  domain_error A value is infinite or NaN
+   */
+  float quantize(const std::vector<float>& row) {
+    float max = 0;
+
+    for (size_t k = 0; k < row.size(); ++k) {
+      if (!std::isfinite(row[k])) throw std::domain_error("non-finite value");
+
+      float v = row[k] < 0 ? -row[k] : row[k];
+
+      if (v > max) max = v;
+    }
+
+    float scale = max / 127;
+
+    for (size_t k = 0; k < row.size(); ++k) {
+      float q = scale > 0 ? row[k] / scale : 0;
+
+      // a subnormal scale is inexact, keep the cast in range
+      if (q > 127) q = 127;
+      if (q < -127) q = -127;
+
+      values_.push_back(static_cast<int8_t>(q < 0 ? q - 0.5f : q + 0.5f));
+    }
+
+    return scale;
+  }
+
+ public:
+  /**
+   * Quantize a SparseMatrix of generic type Q, visiting its list only once.
+   * @brief Converting constructor
+   * @param other SparseMatrix to quantize
+   * @throw overflow_error A column delta is not representable with I
+   * @throw domain_error   A value is infinite or NaN as a float
+   */
+  template <typename Q>
+  explicit QuantizedSparseMatrix(const SparseMatrix<Q>& other)
+      : rows_(other.rows()),
+        cols_(other.cols()),
+        D_(static_cast<float>(other.D())),
+        offsets_(other.rows() + 1, 0),
+        scales_(other.rows(), 0) {
+#ifndef NDEBUG
+    std::cout << "QuantizedSparseMatrix::QuantizedSparseMatrix("
+                 "const SparseMatrix<Q>&)"
+              << std::endl;
+#endif
+
+    deltas_.reserve(other.size());
+    values_.reserve(other.size());
+
+    typename SparseMatrix<Q>::const_iterator it = other.begin();
+    std::vector<float> row;
+
+    for (size_t i = 0; i < rows_; ++i) {
+      size_t col = origin(i);
+      row.clear();
+
+      for (; it != other.end() && it->i == i; ++it) {
+        if (it->j - col > static_cast<size_t>(std::numeric_limits<I>::max()))
+          throw std::overflow_error("column delta does not fit index type");
+
+        deltas_.push_back(static_cast<I>(it->j - col));
+        row.push_back(static_cast<float>(it->value));
+        col = it->j;
+      }
+
+      scales_[i] = quantize(row);
+      offsets_[i + 1] = values_.size();
+    }
+  }
+
+  /**
+   * Get matrix number of rows.
+   * @brief Rows getter
+   * @return Matrix rows
+   */
+  size_t rows() const { return rows_; }
+
+  /**
+   * Get matrix number of columns.
+   * @brief Columns getter
+   * @return Matrix columns
+   */
+  size_t cols() const { return cols_; }
+
+  /**
+   * Get the number of elements.
+   * @brief Size getter
+   * @return Matrix size
+   */
+  size_t size() const { return values_.size(); }
+
+  /**
+   * Get the default element.
+   * @brief Default element getter
+   * @return Matrix default element's value
+   */
+  float D() const { return D_; }
+
+  /**
+   * Get the number of bytes used by offsets, deltas, values and scales.
+   * @brief Memory footprint getter
+   * @return Bytes of storage
+   */
+  size_t bytes() const {
+    return offsets_.size() * sizeof(size_t) + deltas_.size() * sizeof(I) +
+           values_.size() * sizeof(int8_t) + scales_.size() * sizeof(float);
+  }
+
+  /**
+   * Return the dequantized element at the given coordinates.
+   * @brief Matrix get element
+   * @param  i Index of element relative to matrix rows, unsigned value
+   * @param  j Index of element relative to matrix columns, unsigned value
+   * @return Matrix element
+   * @throw  out_of_range Indices i or j are equal or greater than rows or cols
+   */
+  float operator()(size_t i, size_t j) const {
+    if (i >= rows_ || j >= cols_)
+      throw std::out_of_range("i or j out of bounds");
+
+    size_t col = origin(i);
+
+    for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+      col += deltas_[k];
+
+      if (col == j) return scales_[i] * values_[k];
+      if (col > j) break;
+    }
+
+    return D_;
+  }
+
+  /**
+   * Compute y = A * x, dequantizing each row on the fly as
+   * scale * sum(q * x) - D * sum(x) over its stored elements, plus
+   * D * sum(x) over the whole vector. Both row sums are accumulated in the
+   * same loop, so each x[j] is read once.
+   * @brief Matrix-vector multiplication
+   * @param x       Input vector, cols() values of generic type Q
+   * @param y       Output vector, rows() values of generic type Q
+   * @param threads Number of threads (default: 1)
+   */
+  template <typename Q>
+  void multiply(const Q* x, Q* y, int threads = 1) const {
+    const Q d = static_cast<Q>(D_);
+    const ptrdiff_t rows = static_cast<ptrdiff_t>(rows_);
+    Q base = Q();
+
+    if (d != Q()) {
+      for (size_t j = 0; j < cols_; ++j) base += x[j];
+
+      base *= d;
+    }
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+    for (ptrdiff_t i = 0; i < rows; ++i) {
+      size_t col = origin(i);
+      Q dot = Q(), stored = Q();
+
+      for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+        const Q value = x[col += deltas_[k]];
+
+        dot += static_cast<Q>(values_[k]) * value;
+        stored += value;
+      }
+
+      y[i] = base + static_cast<Q>(scales_[i]) * dot - d * stored;
+    }
+  }
+
+  /**
+   * Perform matrix-vector multiplication and return the result.
+   * @brief Matrix-vector multiplication operator
+   * @param  x Input vector, cols() values of generic type Q
+   * @return Vector of rows() values
+   * @throw  out_of_range x size differs from matrix columns
+   */
+  template <typename Q>
+  std::vector<Q> operator*(const std::vector<Q>& x) const {
+    if (x.size() != cols_) throw std::out_of_range("x.size() != m.cols()");
+
+    std::vector<Q> y(rows_);
+
+    if (rows_ > 0) multiply(x.empty() ? 0 : &x[0], &y[0]);
+
+    return y;
+  }
+
+  /**
+   * Overloading of operator<<.
+   * @brief Matrix ostream operator
+   * @param  os Output stream
+   * @param  m  Matrix
+   * @return Updated output stream
+   */
+  friend std::ostream& operator<<(std::ostream& os,
+                                  const QuantizedSparseMatrix& m) {
+    os << "[";
+
+    for (size_t i = 0; i < m.rows_; ++i) {
+      if (i > 0) os << ",\n ";
+
+      os << "[";
+
+      for (size_t j = 0; j < m.cols_; ++j) {
+        if (j > 0) os << ",\t";
+
+        os << m(i, j);
+      }
+
+      os << "]";
+    }
+
+    os << "]";
+
+    return os;
+  }
+};
+
+#endif
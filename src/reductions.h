@@ -0,0 +1,447 @@
+#ifndef REDUCTIONS_H_
+#define REDUCTIONS_H_
+
+#include <cmath>      // std::sqrt
+#include <cstddef>    // std::ptrdiff_t
+#include <stdexcept>  // std::out_of_range
+#include <vector>     // std::vector
+
+#include "compressedmatrix.h"
+#include "sparsematrix.h"
+
+// Helpers of the reductions below, not part of the interface
+namespace detail {
+
+/// Rows summed by one task of the parallel reductions, fixed so that the
+/// order of the floating point additions does not depend on the threads
+static const size_t reduction_block = 1024;
+
+/**
+ * Kahan compensated summation, keeping the rounding error of each addition.
+ * @brief Compensated sum struct
+ */
+template <typename T>
+struct kahan_sum {
+  T sum;           ///< Running sum
+  T compensation;  ///< Low order bits lost by the running sum
+
+  kahan_sum() : sum(T()), compensation(T()) {}
+
+  void add(const T& value) {
+    T y = value - compensation;
+    T t = sum + y;
+    compensation = (t - sum) - y;
+    sum = t;
+  }
+};
+
+/**
+ * Value of a stored element, as is.
+ * @brief Identity reduction operator
+ */
+struct identity_op {
+  template <typename T>
+  T operator()(const T& value) const {
+    return value;
+  }
+};
+
+/**
+ * Square of a stored element.
+ * @brief Square reduction operator
+ */
+struct square_op {
+  template <typename T>
+  T operator()(const T& value) const {
+    return value * value;
+  }
+};
+
+/**
+ * Sum values pairwise, in a fixed tree order.
+ * @brief Pairwise sum
+ * @param  values Values to sum, overwritten
+ * @return Sum of values
+ */
+template <typename T>
+T pairwise_sum(std::vector<T>& values) {
+  if (values.empty()) return T();
+
+  for (size_t step = 1; step < values.size(); step *= 2)
+    for (size_t k = 0; k + step < values.size(); k += 2 * step)
+      values[k] += values[k + step];
+
+  return values[0];
+}
+
+/**
+ * Get the number of unstored elements, each worth D.
+ * @brief Helper for the reductions
+ * @param  m Matrix
+ * @return rows * cols - size
+ */
+template <typename M>
+size_t unstored(const M& m) {
+  return m.rows() * m.cols() - m.size();
+}
+
+/**
+ * Sum the op of every element of the matrix, D included.
+ * @brief Helper for matrix_sum and frobenius_norm
+ * @param  m  Matrix
+ * @param  op Operator applied to each value
+ * @return Sum of op(value)
+ */
+template <typename T, typename F>
+T reduce(const SparseMatrix<T>& m, F op) {
+  kahan_sum<T> total;
+  typename SparseMatrix<T>::const_iterator it;
+
+  for (it = m.begin(); it != m.end(); ++it) total.add(op(it->value));
+
+  return total.sum + static_cast<T>(unstored(m)) * op(m.D());
+}
+
+/**
+ * Sum the op of every element of the matrix, D included: each row block is
+ * summed by one thread, block sums are then added pairwise.
+ * @brief Helper for matrix_sum and frobenius_norm
+ * @param  m       Matrix
+ * @param  op      Operator applied to each value
+ * @param  threads Number of threads
+ * @return Sum of op(value)
+ */
+template <typename T, typename I, typename F>
+T reduce(const CompressedSparseMatrix<T, I>& m, F op, int threads) {
+  const ptrdiff_t blocks = static_cast<ptrdiff_t>(
+      (m.rows() + reduction_block - 1) / reduction_block);
+  std::vector<T> partial(blocks);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+  for (ptrdiff_t b = 0; b < blocks; ++b) {
+    size_t first = b * reduction_block, last = first + reduction_block;
+    kahan_sum<T> block;
+
+    if (last > m.rows()) last = m.rows();
+
+    for (size_t i = first; i < last; ++i) {
+      const T* values = m.row_values(i);
+
+      for (size_t k = 0; k < m.row_size(i); ++k) block.add(op(values[k]));
+    }
+
+    partial[b] = block.sum;
+  }
+
+  return pairwise_sum(partial) + static_cast<T>(unstored(m)) * op(m.D());
+}
+
+/**
+ * Find the minimum (or maximum) element of the matrix, one thread per row
+ * block.
+ * @brief Helper for min_value and max_value
+ * @param  m       Matrix
+ * @param  greater Look for the maximum instead of the minimum
+ * @param  threads Number of threads
+ * @return Minimum or maximum element
+ * @throw  out_of_range Matrix has no elements
+ */
+template <typename T, typename I>
+T extreme(const CompressedSparseMatrix<T, I>& m, bool greater, int threads) {
+  if (m.rows() == 0 || m.cols() == 0) throw std::out_of_range("empty matrix");
+
+  if (m.size() == 0) return m.D();
+
+  const ptrdiff_t blocks = static_cast<ptrdiff_t>(
+      (m.rows() + reduction_block - 1) / reduction_block);
+  const T first_value = *m.row_values(0);
+  std::vector<T> partial(blocks, unstored(m) > 0 ? m.D() : first_value);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+  for (ptrdiff_t b = 0; b < blocks; ++b) {
+    size_t first = b * reduction_block, last = first + reduction_block;
+    T result = partial[b];
+
+    if (last > m.rows()) last = m.rows();
+
+    for (size_t i = first; i < last; ++i) {
+      const T* values = m.row_values(i);
+
+      for (size_t k = 0; k < m.row_size(i); ++k)
+        if (greater ? result < values[k] : values[k] < result)
+          result = values[k];
+    }
+
+    partial[b] = result;
+  }
+
+  T result = partial[0];
+
+  for (ptrdiff_t b = 1; b < blocks; ++b)
+    if (greater ? result < partial[b] : partial[b] < result)
+      result = partial[b];
+
+  return result;
+}
+
+}  // namespace detail
+
+// SparseMatrix reductions: the list is visited once, sequentially
+
+/**
+ * Sum each row of the matrix.
+ * @brief Matrix row sums
+ * @param  m Matrix
+ * @return Vector of rows() sums
+ */
+template <typename T>
+std::vector<T> row_sums(const SparseMatrix<T>& m) {
+  std::vector<detail::kahan_sum<T> > sums(m.rows());
+  std::vector<size_t> count(m.rows(), 0);
+  typename SparseMatrix<T>::const_iterator it;
+
+  for (it = m.begin(); it != m.end(); ++it) {
+    sums[it->i].add(it->value);
+    ++count[it->i];
+  }
+
+  std::vector<T> result(m.rows());
+
+  for (size_t i = 0; i < m.rows(); ++i)
+    result[i] = sums[i].sum + static_cast<T>(m.cols() - count[i]) * m.D();
+
+  return result;
+}
+
+/**
+ * Sum each column of the matrix.
+ * @brief Matrix column sums
+ * @param  m Matrix
+ * @return Vector of cols() sums
+ */
+template <typename T>
+std::vector<T> col_sums(const SparseMatrix<T>& m) {
+  std::vector<detail::kahan_sum<T> > sums(m.cols());
+  std::vector<size_t> count(m.cols(), 0);
+  typename SparseMatrix<T>::const_iterator it;
+
+  for (it = m.begin(); it != m.end(); ++it) {
+    sums[it->j].add(it->value);
+    ++count[it->j];
+  }
+
+  std::vector<T> result(m.cols());
+
+  for (size_t j = 0; j < m.cols(); ++j)
+    result[j] = sums[j].sum + static_cast<T>(m.rows() - count[j]) * m.D();
+
+  return result;
+}
+
+/**
+ * Count the stored elements of each row.
+ * @brief Matrix row sizes
+ * @param  m Matrix
+ * @return Vector of rows() counts
+ */
+template <typename T>
+std::vector<size_t> row_nnz(const SparseMatrix<T>& m) {
+  std::vector<size_t> count(m.rows(), 0);
+  typename SparseMatrix<T>::const_iterator it;
+
+  for (it = m.begin(); it != m.end(); ++it) ++count[it->i];
+
+  return count;
+}
+
+/**
+ * Sum every element of the matrix.
+ * @brief Matrix sum
+ * @param  m Matrix
+ * @return Sum of the elements
+ */
+template <typename T>
+T matrix_sum(const SparseMatrix<T>& m) {
+  return detail::reduce(m, detail::identity_op());
+}
+
+/**
+ * Compute the square root of the sum of the squared elements.
+ * @brief Matrix Frobenius norm
+ * @param  m Matrix
+ * @return Frobenius norm
+ */
+template <typename T>
+T frobenius_norm(const SparseMatrix<T>& m) {
+  return std::sqrt(detail::reduce(m, detail::square_op()));
+}
+
+/**
+ * Return the minimum element of the matrix.
+ * @brief Matrix minimum
+ * @param  m Matrix
+ * @return Minimum element, D when smaller than every stored one
+ * @throw  out_of_range Matrix has no elements
+ */
+template <typename T>
+T min_value(const SparseMatrix<T>& m) {
+  if (m.rows() == 0 || m.cols() == 0) throw std::out_of_range("empty matrix");
+
+  typename SparseMatrix<T>::const_iterator it = m.begin();
+  T result = detail::unstored(m) > 0 ? m.D() : it->value;
+
+  for (; it != m.end(); ++it)
+    if (it->value < result) result = it->value;
+
+  return result;
+}
+
+/**
+ * Return the maximum element of the matrix.
+ * @brief Matrix maximum
+ * @param  m Matrix
+ * @return Maximum element, D when greater than every stored one
+ * @throw  out_of_range Matrix has no elements
+ */
+template <typename T>
+T max_value(const SparseMatrix<T>& m) {
+  if (m.rows() == 0 || m.cols() == 0) throw std::out_of_range("empty matrix");
+
+  typename SparseMatrix<T>::const_iterator it = m.begin();
+  T result = detail::unstored(m) > 0 ? m.D() : it->value;
+
+  for (; it != m.end(); ++it)
+    if (result < it->value) result = it->value;
+
+  return result;
+}
+
+// CompressedSparseMatrix reductions: rows are split among threads in blocks
+// of reduction_block, block results are combined in a fixed order
+
+/**
+ * Sum each row of the matrix, one thread per row block.
+ * @brief Matrix row sums
+ * @param  m       Matrix
+ * @param  threads Number of threads (default: 1)
+ * @return Vector of rows() sums
+ */
+template <typename T, typename I>
+std::vector<T> row_sums(const CompressedSparseMatrix<T, I>& m,
+                        int threads = 1) {
+  const ptrdiff_t rows = static_cast<ptrdiff_t>(m.rows());
+  std::vector<T> result(m.rows());
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) \
+    schedule(static, detail::reduction_block)
+#endif
+  for (ptrdiff_t i = 0; i < rows; ++i) {
+    const T* values = m.row_values(i);
+    detail::kahan_sum<T> row;
+
+    for (size_t k = 0; k < m.row_size(i); ++k) row.add(values[k]);
+
+    result[i] = row.sum + static_cast<T>(m.cols() - m.row_size(i)) * m.D();
+  }
+
+  return result;
+}
+
+/**
+ * Sum each column of the matrix. Scattering into the columns is done by a
+ * single thread, since partial column vectors per thread would cost
+ * threads * cols() memory.
+ * @brief Matrix column sums
+ * @param  m Matrix
+ * @return Vector of cols() sums
+ */
+template <typename T, typename I>
+std::vector<T> col_sums(const CompressedSparseMatrix<T, I>& m) {
+  std::vector<detail::kahan_sum<T> > sums(m.cols());
+  std::vector<size_t> count(m.cols(), 0);
+  typename CompressedSparseMatrix<T, I>::const_iterator it;
+
+  for (it = m.begin(); it != m.end(); ++it) {
+    sums[it->j].add(it->value);
+    ++count[it->j];
+  }
+
+  std::vector<T> result(m.cols());
+
+  for (size_t j = 0; j < m.cols(); ++j)
+    result[j] = sums[j].sum + static_cast<T>(m.rows() - count[j]) * m.D();
+
+  return result;
+}
+
+/**
+ * Count the stored elements of each row.
+ * @brief Matrix row sizes
+ * @param  m Matrix
+ * @return Vector of rows() counts
+ */
+template <typename T, typename I>
+std::vector<size_t> row_nnz(const CompressedSparseMatrix<T, I>& m) {
+  std::vector<size_t> count(m.rows());
+
+  for (size_t i = 0; i < m.rows(); ++i) count[i] = m.row_size(i);
+
+  return count;
+}
+
+/**
+ * Sum every element of the matrix.
+ * @brief Matrix sum
+ * @param  m       Matrix
+ * @param  threads Number of threads (default: 1)
+ * @return Sum of the elements
+ */
+template <typename T, typename I>
+T matrix_sum(const CompressedSparseMatrix<T, I>& m, int threads = 1) {
+  return detail::reduce(m, detail::identity_op(), threads);
+}
+
+/**
+ * Compute the square root of the sum of the squared elements.
+ * @brief Matrix Frobenius norm
+ * @param  m       Matrix
+ * @param  threads Number of threads (default: 1)
+ * @return Frobenius norm
+ */
+template <typename T, typename I>
+T frobenius_norm(const CompressedSparseMatrix<T, I>& m, int threads = 1) {
+  return std::sqrt(detail::reduce(m, detail::square_op(), threads));
+}
+
+/**
+ * Return the minimum element of the matrix.
+ * @brief Matrix minimum
+ * @param  m       Matrix
+ * @param  threads Number of threads (default: 1)
+ * @return Minimum element, D when smaller than every stored one
+ * @throw  out_of_range Matrix has no elements
+ */
+template <typename T, typename I>
+T min_value(const CompressedSparseMatrix<T, I>& m, int threads = 1) {
+  return detail::extreme(m, false, threads);
+}
+
+/**
+ * Return the maximum element of the matrix.
+ * @brief Matrix maximum
+ * @param  m       Matrix
+ * @param  threads Number of threads (default: 1)
+ * @return Maximum element, D when greater than every stored one
+ * @throw  out_of_range Matrix has no elements
+ */
+template <typename T, typename I>
+T max_value(const CompressedSparseMatrix<T, I>& m, int threads = 1) {
+  return detail::extreme(m, true, threads);
+}
+
+#endif
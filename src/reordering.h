@@ -0,0 +1,228 @@
+#ifndef REORDERING_H_
+#define REORDERING_H_
+
+#include <algorithm>  // std::reverse, std::sort
+#include <cstddef>    // size_t
+#include <stdexcept>  // std::out_of_range
+#include <vector>     // std::vector
+
+#include "sparsematrix.h"
+
+// Helpers of the orderings below, not part of the interface
+namespace detail {
+
+/**
+ * Adjacency lists of the symmetric pattern of A + A^T (diagonal excluded).
+ * @brief Matrix graph struct
+ */
+struct pattern_graph {
+  std::vector<size_t> offsets;     ///< Vertex v is [offsets[v], [v + 1])
+  std::vector<size_t> neighbours;  ///< Concatenated adjacency lists
+
+  /**
+   * Build the graph of a square matrix in O(size log size + rows), sorting
+   * each adjacency list to drop duplicates.
+   * @brief Matrix graph constructor
+   * @param m Square matrix
+   * @throw out_of_range Matrix is not square
+   */
+  template <typename T>
+  explicit pattern_graph(const SparseMatrix<T>& m)
+      : offsets(m.rows() + 1, 0) {
+    if (m.rows() != m.cols()) throw std::out_of_range("m.rows() != m.cols()");
+
+    typename SparseMatrix<T>::const_iterator it;
+
+    for (it = m.begin(); it != m.end(); ++it) {
+      if (it->i == it->j) continue;
+
+      ++offsets[it->i + 1];
+      ++offsets[it->j + 1];
+    }
+
+    for (size_t v = 0; v < m.rows(); ++v) offsets[v + 1] += offsets[v];
+
+    std::vector<size_t> next(offsets.begin(), offsets.end() - 1);
+    neighbours.resize(offsets.back());
+
+    for (it = m.begin(); it != m.end(); ++it) {
+      if (it->i == it->j) continue;
+
+      neighbours[next[it->i]++] = it->j;
+      neighbours[next[it->j]++] = it->i;
+    }
+
+    // drop the duplicates given by elements stored in both triangles
+    size_t size = 0;
+
+    for (size_t v = 0; v + 1 < offsets.size(); ++v) {
+      size_t first = offsets[v], last = offsets[v + 1];
+
+      std::sort(neighbours.begin() + first, neighbours.begin() + last);
+      offsets[v] = size;
+
+      for (size_t k = first; k < last; ++k)
+        if (k == first || neighbours[k] != neighbours[k - 1])
+          neighbours[size++] = neighbours[k];
+    }
+
+    offsets.back() = size;
+    neighbours.resize(size);
+  }
+
+  /**
+   * Get the number of neighbours of vertex v.
+   * @brief Degree getter
+   * @param  v Vertex
+   * @return Degree of v
+   */
+  size_t degree(size_t v) const { return offsets[v + 1] - offsets[v]; }
+};
+
+/**
+ * Compares vertices by degree, breaking ties by index.
+ * @brief Degree comparator
+ */
+struct degree_less {
+  const pattern_graph& g;  ///< Graph of the vertices
+
+  explicit degree_less(const pattern_graph& g) : g(g) {}
+
+  bool operator()(size_t a, size_t b) const {
+    return g.degree(a) < g.degree(b) || (g.degree(a) == g.degree(b) && a < b);
+  }
+};
+
+}  // namespace detail
+
+/**
+ * Compute the permutation listing rows by increasing number of neighbours
+ * in the symmetric pattern.
+ * @brief Degree-based reordering
+ * @param  m Square matrix
+ * @return Permutation p, to be used as m.permute(p, p)
+ */
+template <typename T>
+std::vector<size_t> degree_ordering(const SparseMatrix<T>& m) {
+  detail::pattern_graph g(m);
+  std::vector<size_t> p(m.rows());
+
+  for (size_t v = 0; v < p.size(); ++v) p[v] = v;
+
+  std::sort(p.begin(), p.end(), detail::degree_less(g));
+
+  return p;
+}
+
+/**
+ * Compute the Reverse Cuthill-McKee permutation: a breadth-first visit of
+ * the symmetric pattern, starting each connected component from its vertex of
+ * minimum degree and visiting neighbours by increasing degree, reversed.
+ * Adjacent rows get close indices, reducing the matrix bandwidth.
+ * @brief Reverse Cuthill-McKee reordering
+ * @param  m Square matrix
+ * @return Permutation p, to be used as m.permute(p, p)
+ */
+template <typename T>
+std::vector<size_t> reverse_cuthill_mckee(const SparseMatrix<T>& m) {
+  detail::pattern_graph g(m);
+  const size_t n = m.rows();
+
+  std::vector<size_t> start(n), p;
+  std::vector<bool> visited(n, false);
+  detail::degree_less less(g);
+
+  for (size_t v = 0; v < n; ++v) start[v] = v;
+
+  std::sort(start.begin(), start.end(), less);
+  p.reserve(n);
+
+  for (size_t s = 0; s < n; ++s) {
+    if (visited[start[s]]) continue;
+
+    visited[start[s]] = true;
+    p.push_back(start[s]);
+
+    // p itself is the breadth-first queue
+    for (size_t head = p.size() - 1; head < p.size(); ++head) {
+      size_t v = p[head], first = p.size();
+
+      for (size_t k = g.offsets[v]; k < g.offsets[v + 1]; ++k) {
+        if (visited[g.neighbours[k]]) continue;
+
+        visited[g.neighbours[k]] = true;
+        p.push_back(g.neighbours[k]);
+      }
+
+      std::sort(p.begin() + first, p.end(), less);
+    }
+  }
+
+  std::reverse(p.begin(), p.end());
+
+  return p;
+}
+
+/**
+ * Return the maximum distance |i - j| of a stored element from the diagonal.
+ * @brief Matrix bandwidth
+ * @param  m Matrix
+ * @return Bandwidth
+ */
+template <typename T>
+size_t bandwidth(const SparseMatrix<T>& m) {
+  size_t width = 0;
+  typename SparseMatrix<T>::const_iterator it;
+
+  for (it = m.begin(); it != m.end(); ++it) {
+    size_t d = it->i > it->j ? it->i - it->j : it->j - it->i;
+
+    if (d > width) width = d;
+  }
+
+  return width;
+}
+
+/**
+ * Return v' with v'[k] = v[p[k]], the vector matching m.permute(p, q) when p
+ * is its column permutation q.
+ * @brief Vector permutation
+ * @param  v Vector
+ * @param  p Permutation
+ * @return Permuted vector
+ * @throw  out_of_range v and p sizes differ
+ */
+template <typename T>
+std::vector<T> permute_vector(const std::vector<T>& v,
+                              const std::vector<size_t>& p) {
+  if (v.size() != p.size()) throw std::out_of_range("v.size() != p.size()");
+
+  std::vector<T> result(v.size());
+
+  for (size_t k = 0; k < p.size(); ++k) result[k] = v[p[k]];
+
+  return result;
+}
+
+/**
+ * Return v with v[p[k]] = v'[k], undoing permute_vector: used to bring the
+ * result of a product with m.permute(p, q) back to the original row order.
+ * @brief Vector inverse permutation
+ * @param  v Permuted vector
+ * @param  p Permutation
+ * @return Vector in the original order
+ * @throw  out_of_range v and p sizes differ
+ */
+template <typename T>
+std::vector<T> unpermute_vector(const std::vector<T>& v,
+                                const std::vector<size_t>& p) {
+  if (v.size() != p.size()) throw std::out_of_range("v.size() != p.size()");
+
+  std::vector<T> result(v.size());
+
+  for (size_t k = 0; k < p.size(); ++k) result[p[k]] = v[k];
+
+  return result;
+}
+
+#endif
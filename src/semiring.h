@@ -0,0 +1,73 @@
+#ifndef SEMIRING_H_
+#define SEMIRING_H_
+
+#include <limits>  // std::numeric_limits
+
+/*
+ * A semiring replaces + and * in SparseMatrix::multiply. It provides:
+ *   T zero() const;                          identity of add, result's D
+ *   T add(const T& a, const T& b) const;     combines products of a row
+ *   T multiply(const T& a, const T& b) const;
+ * Only stored elements are multiplied, so zero() does not have to annihilate.
+ */
+
+/**
+ * Arithmetic (+, *) semiring, the one of operator*.
+ * @brief Plus-times semiring struct
+ */
+template <typename T>
+struct plus_times {
+  T zero() const { return T(); }
+
+  T add(const T& a, const T& b) const { return a + b; }
+
+  T multiply(const T& a, const T& b) const { return a * b; }
+};
+
+/**
+ * (+, pair) semiring: each product counts as 1, whatever the values. Used to
+ * count paths, e.g. triangles as sum(A * A masked by A).
+ * @brief Plus-pair semiring struct
+ */
+template <typename T>
+struct plus_pair {
+  T zero() const { return T(); }
+
+  T add(const T& a, const T& b) const { return a + b; }
+
+  T multiply(const T&, const T&) const { return T(1); }
+};
+
+/**
+ * Tropical (min, +) semiring: a product extends paths by an edge weight and
+ * the sum keeps the shortest one.
+ * @brief Min-plus semiring struct
+ */
+template <typename T>
+struct min_plus {
+  T zero() const {
+    return std::numeric_limits<T>::has_infinity
+               ? std::numeric_limits<T>::infinity()
+               : std::numeric_limits<T>::max();
+  }
+
+  T add(const T& a, const T& b) const { return b < a ? b : a; }
+
+  T multiply(const T& a, const T& b) const { return a + b; }
+};
+
+/**
+ * Boolean (or, and) semiring: reachability, e.g. one step of a breadth-first
+ * search as a frontier vector (1 x n) times the adjacency matrix.
+ * @brief Or-and semiring struct
+ */
+template <typename T = bool>
+struct or_and {
+  T zero() const { return T(); }
+
+  T add(const T& a, const T& b) const { return a || b; }
+
+  T multiply(const T& a, const T& b) const { return a && b; }
+};
+
+#endif
@@ -0,0 +1,474 @@
+#ifndef SHARED_MATRIX_H_
+#define SHARED_MATRIX_H_
+
+#include <fcntl.h>     // O_CREAT, O_EXCL, O_RDONLY, O_RDWR
+#include <sys/mman.h>  // mmap, munmap, shm_open, shm_unlink
+#include <sys/stat.h>  // fstat
+#include <unistd.h>    // close, ftruncate
+
+#include <atomic>       // std::atomic, ATOMIC_LLONG_LOCK_FREE
+#include <cerrno>       // errno
+#include <cstdint>      // uint64_t
+#include <cstring>      // std::memcpy, std::strerror
+#include <new>          // placement new
+#include <sstream>      // std::ostringstream
+#include <stdexcept>    // std::runtime_error
+#include <string>       // std::string
+#include <type_traits>  // std::is_trivially_copyable
+
+#include "compressedmatrix.h"
+#include "sparsematrix.h"
+
+/**
+ * Read-only CompressedSparseMatrix published once into POSIX shared memory
+ * and attached by other processes in O(1), without copying it.
+ *
+ * The matrix published under name lives in the segment "name.generation":
+ * a header followed by the offsets, column deltas and values arrays, located
+ * by byte offsets from the start of the segment so that every process can map
+ * it at a different address. The segment "name" holds the current generation:
+ * publishing again writes a new segment and swaps the generation atomically,
+ * attached processes keep their mapping until they call refresh. Removing
+ * marks "name" as removed before unlinking it, so that attached processes
+ * see it as stale and refresh maps the "name" of the next publish.
+ *
+ * T and I must be trivially copyable, and a single process at a time may
+ * publish under a given name.
+ * @brief Shared memory sparse matrix templated class
+ */
+template <typename T, typename I = uint32_t>
+class SharedSparseMatrix {
+ private:
+  /// Tells a published matrix segment from an unrelated one
+  static const uint64_t magic = 0x5350415253454d32ULL;
+
+  /// Alignment of the arrays in the segment, a cache line
+  static const size_t alignment = 64;
+
+  /// Generation of a removed control segment
+  static const uint64_t removed = ~0ULL;
+
+  /**
+   * Matrix segment header, all positions are byte offsets from its start.
+   * @brief Matrix segment header struct
+   */
+  struct header {
+    uint64_t magic;       ///< Segment identifier
+    uint64_t generation;  ///< Generation the segment was published as
+    uint64_t rows;        ///< Matrix rows
+    uint64_t cols;        ///< Matrix cols
+    uint64_t index_size;  ///< sizeof(I) of the publisher
+    uint64_t value_size;  ///< sizeof(T) of the publisher
+    uint64_t offsets_at;  ///< Position of the rows + 1 offsets
+    uint64_t deltas_at;   ///< Position of the column deltas
+    uint64_t values_at;   ///< Position of the values
+    uint64_t default_at;  ///< Position of the default element's value
+    uint64_t bytes;       ///< Segment size
+  };
+
+  /**
+   * Control segment, shared by publisher and attached processes.
+   * @brief Control segment struct
+   */
+  struct control {
+    std::atomic<uint64_t> generation;  ///< Last published generation, 0: none
+  };
+
+  // a lock-based atomic keeps its lock in the process, not in the segment
+  static_assert(ATOMIC_LONG_LOCK_FREE == 2 && ATOMIC_LLONG_LOCK_FREE == 2,
+                "shared generation needs a lock-free 64 bit atomic");
+
+  // the arrays are copied into the segment and read back in place
+  static_assert(std::is_trivially_copyable<T>::value &&
+                    std::is_trivially_copyable<I>::value,
+                "T and I must be trivially copyable");
+
+  std::string name_;  ///< Name the matrix is published under
+
+  control* control_;     ///< Mapped control segment, read-only
+  void* data_;           ///< Mapped matrix segment
+  size_t bytes_;         ///< Size of the mapped matrix segment
+  uint64_t generation_;  ///< Generation of the mapped matrix segment
+
+  CompressedSparseMatrix<T, I>* matrix_;  ///< View over the mapped arrays
+
+  /**
+   * Prevents copies, each instance owns its mappings.
+   * @brief Copy constructor
+   */
+  SharedSparseMatrix(const SharedSparseMatrix&);
+
+  /**
+   * Prevents copies, each instance owns its mappings.
+   * @brief Assignment operator
+   */
+  SharedSparseMatrix& operator=(const SharedSparseMatrix&);
+
+  /**
+   * Build the exception describing the last failed system call.
+   * @brief Helper for error reporting
+   * @param  name Name of the segment
+   * @return Exception to throw
+   */
+  static std::runtime_error error(const std::string& name) {
+    return std::runtime_error(name + ": " + std::strerror(errno));
+  }
+
+  /**
+   * Return the name of the segment of a generation.
+   * @brief Helper for segment naming
+   * @param  name       Name the matrix is published under
+   * @param  generation Generation
+   * @return Segment name
+   */
+  static std::string segment(const std::string& name, uint64_t generation) {
+    std::ostringstream os;
+    os << name << "." << generation;
+
+    return os.str();
+  }
+
+  /**
+   * Round a position up to the array alignment.
+   * @brief Helper for the segment layout
+   * @param  at Position
+   * @return Aligned position
+   */
+  static uint64_t align(uint64_t at) {
+    return (at + alignment - 1) / alignment * alignment;
+  }
+
+  /**
+   * Map the control segment, creating it if needed. Without create the
+   * segment is opened and mapped read-only, so that attached processes only
+   * need read permission.
+   * @brief Helper for publish and attach
+   * @param  name   Name the matrix is published under
+   * @param  create Create the segment if it does not exist, map it writable
+   * @return Mapped control segment
+   * @throw  runtime_error The segment cannot be opened or mapped
+   */
+  static control* map_control(const std::string& name, bool create) {
+    int fd = shm_open(name.c_str(), create ? O_RDWR | O_CREAT : O_RDONLY, 0600);
+    if (fd < 0) throw error(name);
+
+    struct stat st;
+
+    if (fstat(fd, &st) != 0) {
+      close(fd);
+      throw error(name);
+    }
+
+    bool empty = st.st_size == 0;
+
+    if (empty && (!create || ftruncate(fd, sizeof(control)) != 0)) {
+      close(fd);
+      throw std::runtime_error(name + ": nothing published");
+    }
+
+    int prot = create ? PROT_READ | PROT_WRITE : PROT_READ;
+    void* p = mmap(0, sizeof(control), prot, MAP_SHARED, fd, 0);
+    close(fd);
+
+    if (p == MAP_FAILED) throw error(name);
+
+    // a new segment is zero filled, i.e. generation 0
+    if (empty) new (p) control();
+
+    return static_cast<control*>(p);
+  }
+
+  /**
+   * Map the matrix segment of the current generation and wrap it. If the
+   * control segment was removed, map the one that replaced it first.
+   * @brief Helper for the constructor and refresh
+   * @throw runtime_error The segment cannot be mapped or is not valid
+   */
+  void attach() {
+    for (;;) {
+      uint64_t generation =
+          control_->generation.load(std::memory_order_acquire);
+
+      if (generation == removed) {
+        control* c = map_control(name_, false);
+
+        munmap(control_, sizeof(control));
+        control_ = c;
+        continue;
+      }
+
+      if (generation == 0)
+        throw std::runtime_error(name_ + ": nothing published");
+
+      std::string name = segment(name_, generation);
+      int fd = shm_open(name.c_str(), O_RDONLY, 0);
+
+      // the publisher swapped and removed the segment meanwhile, retry
+      if (fd < 0 && errno == ENOENT &&
+          control_->generation.load(std::memory_order_acquire) != generation)
+        continue;
+
+      if (fd < 0) throw error(name);
+
+      struct stat st;
+
+      if (fstat(fd, &st) != 0) {
+        close(fd);
+        throw error(name);
+      }
+
+      size_t bytes = static_cast<size_t>(st.st_size);
+      void* p = mmap(0, bytes, PROT_READ, MAP_SHARED, fd, 0);
+      close(fd);
+
+      if (p == MAP_FAILED) throw error(name);
+
+      const header* h = static_cast<const header*>(p);
+
+      if (bytes < sizeof(header) || h->magic != magic || h->bytes != bytes ||
+          h->index_size != sizeof(I) || h->value_size != sizeof(T)) {
+        munmap(p, bytes);
+        throw std::runtime_error(name + ": not a matrix of this type");
+      }
+
+      const char* base = static_cast<const char*>(p);
+      T D;
+      std::memcpy(&D, base + h->default_at, sizeof(T));
+
+      CompressedSparseMatrix<T, I>* matrix;
+
+      try {
+        matrix = new CompressedSparseMatrix<T, I>(
+            h->rows, h->cols, D,
+            reinterpret_cast<const size_t*>(base + h->offsets_at),
+            reinterpret_cast<const I*>(base + h->deltas_at),
+            reinterpret_cast<const T*>(base + h->values_at));
+      } catch (...) {
+        munmap(p, bytes);
+        throw;
+      }
+
+      detach();
+
+      data_ = p;
+      bytes_ = bytes;
+      generation_ = generation;
+      matrix_ = matrix;
+
+      return;
+    }
+  }
+
+  /**
+   * Unmap the matrix segment.
+   * @brief Helper for the destructor and refresh
+   */
+  void detach() {
+    delete matrix_;
+    matrix_ = 0;
+
+    if (data_) munmap(data_, bytes_);
+    data_ = 0;
+    bytes_ = 0;
+  }
+
+ public:
+  /**
+   * Copy a compressed matrix into a new shared memory segment, then make it
+   * the current generation of name and remove the previous one.
+   * @brief Matrix publish
+   * @param  name Name to publish under, starting with '/'
+   * @param  m    Matrix to publish
+   * @return Published generation
+   * @throw  runtime_error A segment cannot be created or mapped
+   */
+  static uint64_t publish(const std::string& name,
+                          const CompressedSparseMatrix<T, I>& m) {
+    control* c = map_control(name, true);
+    uint64_t generation = c->generation.load(std::memory_order_acquire) + 1;
+    std::string data = segment(name, generation);
+
+    header h;
+    h.magic = magic;
+    h.generation = generation;
+    h.rows = m.rows();
+    h.cols = m.cols();
+    h.index_size = sizeof(I);
+    h.value_size = sizeof(T);
+    h.offsets_at = align(sizeof(header));
+    h.deltas_at = align(h.offsets_at + (m.rows() + 1) * sizeof(size_t));
+    h.values_at = align(h.deltas_at + m.size() * sizeof(I));
+    h.default_at = align(h.values_at + m.size() * sizeof(T));
+    h.bytes = h.default_at + sizeof(T);
+
+    // leftover of a publisher that failed before swapping
+    shm_unlink(data.c_str());
+
+    int fd = shm_open(data.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+    void* p = MAP_FAILED;
+
+    if (fd >= 0 && ftruncate(fd, h.bytes) == 0)
+      p = mmap(0, h.bytes, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+
+    if (p == MAP_FAILED) {
+      std::runtime_error e = error(data);
+
+      if (fd >= 0) {
+        close(fd);
+        shm_unlink(data.c_str());
+      }
+
+      munmap(c, sizeof(control));
+      throw e;
+    }
+
+    close(fd);
+
+    char* base = static_cast<char*>(p);
+    T D = m.D();
+
+    std::memcpy(base + h.offsets_at, m.offsets(),
+                (m.rows() + 1) * sizeof(size_t));
+    std::memcpy(base + h.deltas_at, m.deltas(), m.size() * sizeof(I));
+    std::memcpy(base + h.values_at, m.values(), m.size() * sizeof(T));
+    std::memcpy(base + h.default_at, &D, sizeof(T));
+    std::memcpy(base, &h, sizeof(header));
+    munmap(p, h.bytes);
+
+    // swap: attached processes keep mapping the previous segment
+    c->generation.store(generation, std::memory_order_release);
+
+    if (generation > 1) shm_unlink(segment(name, generation - 1).c_str());
+
+    munmap(c, sizeof(control));
+
+    return generation;
+  }
+
+  /**
+   * Compress a SparseMatrix of generic type Q and publish it.
+   * @brief Matrix publish
+   * @param  name Name to publish under, starting with '/'
+   * @param  m    Matrix to publish
+   * @return Published generation
+   * @throw  runtime_error A segment cannot be created or mapped
+   */
+  template <typename Q>
+  static uint64_t publish(const std::string& name, const SparseMatrix<Q>& m) {
+    CompressedSparseMatrix<T, I> c(m);
+
+    return publish(name, c);
+  }
+
+  /**
+   * Remove the segments of name: attached processes keep their mappings, and
+   * their next refresh attaches to the matrix published again under name.
+   * @brief Matrix remove
+   * @param name Name the matrix is published under
+   */
+  static void remove(const std::string& name) {
+    int fd = shm_open(name.c_str(), O_RDWR, 0);
+
+    if (fd < 0) return;
+
+    void* p = mmap(0, sizeof(control), PROT_READ | PROT_WRITE, MAP_SHARED, fd,
+                   0);
+    close(fd);
+
+    if (p != MAP_FAILED) {
+      // attached processes still mapping this segment see it as stale
+      uint64_t generation = static_cast<control*>(p)->generation.exchange(
+          removed, std::memory_order_acq_rel);
+
+      if (generation > 0 && generation != removed)
+        shm_unlink(segment(name, generation).c_str());
+
+      munmap(p, sizeof(control));
+    }
+
+    shm_unlink(name.c_str());
+  }
+
+  /**
+   * Attach to the current generation of a published matrix.
+   * @brief Attach constructor
+   * @param name Name the matrix is published under
+   * @throw runtime_error Nothing is published under name
+   */
+  explicit SharedSparseMatrix(const std::string& name)
+      : name_(name),
+        control_(0),
+        data_(0),
+        bytes_(0),
+        generation_(0),
+        matrix_(0) {
+#ifndef NDEBUG
+    std::cout << "SharedSparseMatrix::SharedSparseMatrix(const std::string&)"
+              << std::endl;
+#endif
+
+    control_ = map_control(name, false);
+
+    try {
+      attach();
+    } catch (...) {
+      munmap(control_, sizeof(control));
+      throw;
+    }
+  }
+
+  /**
+   * Unmap the segments.
+   * @brief Destructor
+   */
+  ~SharedSparseMatrix() {
+#ifndef NDEBUG
+    std::cout << "SharedSparseMatrix::~SharedSparseMatrix()" << std::endl;
+#endif
+
+    detach();
+    munmap(control_, sizeof(control));
+  }
+
+  /**
+   * Get the generation of the attached matrix.
+   * @brief Generation getter
+   * @return Attached generation
+   */
+  uint64_t generation() const { return generation_; }
+
+  /**
+   * Check whether a newer generation has been published, or the matrix was
+   * removed.
+   * @brief Matrix stale check
+   * @return True if refresh would attach a new matrix
+   */
+  bool stale() const {
+    return control_->generation.load(std::memory_order_acquire) != generation_;
+  }
+
+  /**
+   * Attach to the current generation, if newer. References returned by
+   * matrix() before a successful refresh are invalidated.
+   * @brief Matrix refresh
+   * @return True if a new matrix was attached
+   * @throw  runtime_error The new segment cannot be mapped, or the matrix was
+   *                       removed and nothing is published under name again
+   */
+  bool refresh() {
+    if (!stale()) return false;
+
+    attach();
+
+    return true;
+  }
+
+  /**
+   * Get the attached matrix, a view over the shared segment.
+   * @brief Matrix getter
+   * @return Attached matrix
+   */
+  const CompressedSparseMatrix<T, I>& matrix() const { return *matrix_; }
+};
+
+#endif
@@ -0,0 +1,729 @@
+#ifndef SOLVERS_H_
+#define SOLVERS_H_
+
+#include <cmath>      // std::sqrt
+#include <cstddef>    // std::ptrdiff_t
+#include <stdexcept>  // std::out_of_range, std::domain_error
+#include <vector>     // std::vector
+
+#include "compressedmatrix.h"
+#include "sparsematrix.h"
+#include "triangular.h"
+
+/**
+ * Stopping criteria and parallelism of the iterative solvers.
+ * @brief Solver options struct
+ */
+struct solver_options {
+  double tolerance;       ///< Relative residual ||b - Ax|| / ||b|| to reach
+  size_t max_iterations;  ///< Maximum number of iterations
+  int threads;            ///< Number of threads used by the kernels
+
+  /**
+   * Create solver options, by default single-threaded.
+   * @brief Solver options constructor
+   * @param tolerance      Relative residual to reach (default: 1e-8)
+   * @param max_iterations Maximum number of iterations (default: 1000)
+   * @param threads        Number of threads (default: 1)
+   */
+  solver_options(double tolerance = 1e-8, size_t max_iterations = 1000,
+                 int threads = 1)
+      : tolerance(tolerance),
+        max_iterations(max_iterations),
+        threads(threads) {}
+};
+
+/**
+ * Outcome of an iterative solver run.
+ * @brief Solver result struct
+ */
+struct solver_result {
+  bool converged;     ///< Tolerance was reached
+  size_t iterations;  ///< Number of iterations performed
+  double residual;    ///< Last relative residual
+
+  solver_result() : converged(false), iterations(0), residual(0) {}
+};
+
+/**
+ * Convergence callback that never stops the solver.
+ * @brief Empty solver callback
+ */
+struct no_callback {
+  bool operator()(size_t, double) const { return true; }
+};
+
+/**
+ * Preconditioner leaving the residual untouched, z = r.
+ * @brief Identity preconditioner
+ */
+template <typename T>
+struct IdentityPreconditioner {
+  void apply(const T* r, T* z, size_t n, int threads = 1) const {
+    const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+    for (ptrdiff_t i = 0; i < size; ++i) z[i] = r[i];
+  }
+};
+
+/**
+ * Preconditioner scaling the residual by the inverse of the diagonal.
+ * @brief Jacobi preconditioner templated class
+ */
+template <typename T>
+class JacobiPreconditioner {
+ public:
+  /**
+   * Store the inverse of the diagonal of a square matrix.
+   * @brief Jacobi preconditioner constructor
+   * @param m Square matrix
+   * @throw domain_error A diagonal element is zero
+   */
+  template <typename I>
+  explicit JacobiPreconditioner(const CompressedSparseMatrix<T, I>& m)
+      : inverse_(m.rows()) {
+    for (size_t i = 0; i < m.rows(); ++i) {
+      T d = m(i, i);
+
+      if (d == T()) throw std::domain_error("zero diagonal element");
+
+      inverse_[i] = T(1) / d;
+    }
+  }
+
+  /**
+   * Compute z = D^-1 * r.
+   * @brief Preconditioner apply
+   * @param r       Residual, n values
+   * @param z       Preconditioned residual, n values
+   * @param n       Size of the vectors
+   * @param threads Number of threads (default: 1)
+   */
+  void apply(const T* r, T* z, size_t n, int threads = 1) const {
+    const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+    const T* inverse = &inverse_[0];
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+    for (ptrdiff_t i = 0; i < size; ++i) z[i] = inverse[i] * r[i];
+  }
+
+ private:
+  std::vector<T> inverse_;  ///< Inverse of the diagonal elements
+};
+
+/**
+ * Incomplete LU factorization with the sparsity pattern of the stored
+ * elements (unstored elements are treated as zero).
+ * @brief ILU(0) preconditioner templated class
+ */
+template <typename T>
+class ILU0Preconditioner {
+ public:
+  /**
+   * Factorize a square matrix in place of a copy of its stored elements.
+   * @brief ILU(0) preconditioner constructor
+   * @param m Square matrix
+   * @throw domain_error A pivot is zero or missing
+   */
+  template <typename I>
+  explicit ILU0Preconditioner(const CompressedSparseMatrix<T, I>& m)
+      : n_(m.rows()), offsets_(m.rows() + 1, 0), diag_(m.rows()) {
+    cols_.resize(m.size());
+    values_.reserve(m.size());
+
+    size_t* cols = cols_.empty() ? 0 : &cols_[0];
+
+    for (size_t i = 0; i < n_; ++i) {
+      offsets_[i + 1] = offsets_[i] + m.decode_row(i, cols + offsets_[i]);
+      values_.insert(values_.end(), m.row_values(i),
+                     m.row_values(i) + m.row_size(i));
+    }
+
+    factorize();
+    schedule();
+  }
+
+  /**
+   * Compute z = (LU)^-1 * r by forward and backward substitution. With more
+   * than one thread, the substitutions go one dependency level at a time and
+   * rows of the same level are solved in parallel; a single thread keeps the
+   * row order, which reads z with better locality.
+   * @brief Preconditioner apply
+   * @param r       Residual, n values
+   * @param z       Preconditioned residual, n values
+   * @param n       Size of the vectors
+   * @param threads Number of threads (default: 1)
+   */
+  void apply(const T* r, T* z, size_t n, int threads = 1) const {
+#ifdef _OPENMP
+    if (threads > 1) {
+      const ptrdiff_t lower = static_cast<ptrdiff_t>(lower_levels_.size()) - 1;
+      const ptrdiff_t upper = static_cast<ptrdiff_t>(upper_levels_.size()) - 1;
+
+#pragma omp parallel num_threads(threads)
+      {
+        // L (unit diagonal) * y = r
+        for (ptrdiff_t l = 0; l < lower; ++l) {
+          const ptrdiff_t first = static_cast<ptrdiff_t>(lower_levels_[l]);
+          const ptrdiff_t last = static_cast<ptrdiff_t>(lower_levels_[l + 1]);
+
+#pragma omp for schedule(static)
+          for (ptrdiff_t o = first; o < last; ++o)
+            forward(r, z, lower_order_[o]);
+        }
+
+        // U * z = y
+        for (ptrdiff_t l = 0; l < upper; ++l) {
+          const ptrdiff_t first = static_cast<ptrdiff_t>(upper_levels_[l]);
+          const ptrdiff_t last = static_cast<ptrdiff_t>(upper_levels_[l + 1]);
+
+#pragma omp for schedule(static)
+          for (ptrdiff_t o = first; o < last; ++o)
+            backward(z, upper_order_[o]);
+        }
+      }
+
+      return;
+    }
+#endif
+
+    for (size_t i = 0; i < n; ++i) forward(r, z, i);
+
+    for (size_t i = n; i-- > 0;) backward(z, i);
+  }
+
+ private:
+  size_t n_;                     ///< Matrix rows
+  std::vector<size_t> offsets_;  ///< Row i is stored in [offsets_[i], [i + 1])
+  std::vector<size_t> cols_;     ///< Column indices
+  std::vector<size_t> diag_;     ///< Position of the diagonal of each row
+  std::vector<T> values_;        ///< L below the diagonal, U from it
+
+  std::vector<size_t> lower_order_;   ///< Rows of L sorted by level
+  std::vector<size_t> lower_levels_;  ///< Levels of L in lower_order_
+  std::vector<size_t> upper_order_;   ///< Rows of U sorted by level
+  std::vector<size_t> upper_levels_;  ///< Levels of U in upper_order_
+
+  /**
+   * Solve row i of L (unit diagonal) * y = r, into z.
+   * @brief Helper for apply
+   * @param r Residual
+   * @param z Solution, rows of L before i already solved
+   * @param i Index of row
+   */
+  void forward(const T* r, T* z, size_t i) const {
+    T sum = r[i];
+
+    for (size_t k = offsets_[i]; k < diag_[i]; ++k)
+      sum -= values_[k] * z[cols_[k]];
+
+    z[i] = sum;
+  }
+
+  /**
+   * Solve row i of U * z = y, in place.
+   * @brief Helper for apply
+   * @param z y, rows of U after i already solved
+   * @param i Index of row
+   */
+  void backward(T* z, size_t i) const {
+    T sum = z[i];
+
+    for (size_t k = diag_[i] + 1; k < offsets_[i + 1]; ++k)
+      sum -= values_[k] * z[cols_[k]];
+
+    z[i] = sum / values_[diag_[i]];
+  }
+
+  /**
+   * Build the level schedules of the two substitutions.
+   * @brief Helper for the constructor
+   */
+  void schedule() {
+    if (n_ == 0) return;
+
+    const size_t* cols = cols_.empty() ? 0 : &cols_[0];
+    std::vector<size_t> above(n_);
+
+    for (size_t i = 0; i < n_; ++i) above[i] = diag_[i] + 1;
+
+    detail::level_schedule(n_, true, &offsets_[0], &diag_[0], cols,
+                           lower_order_, lower_levels_);
+    detail::level_schedule(n_, false, &above[0], &offsets_[0] + 1, cols,
+                           upper_order_, upper_levels_);
+  }
+
+  /**
+   * Run the IKJ variant of Gaussian elimination restricted to the pattern.
+   * @brief Helper for the constructor
+   * @throw domain_error A pivot is zero or missing
+   */
+  void factorize() {
+    const size_t none = static_cast<size_t>(-1);
+    std::vector<size_t> pos(n_, none);
+
+    for (size_t i = 0; i < n_; ++i) {
+      diag_[i] = none;
+
+      for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k) {
+        pos[cols_[k]] = k;
+
+        if (cols_[k] == i) diag_[i] = k;
+      }
+
+      if (diag_[i] == none) throw std::domain_error("missing pivot");
+
+      for (size_t k = offsets_[i]; k < diag_[i]; ++k) {
+        size_t r = cols_[k];
+
+        values_[k] /= values_[diag_[r]];
+
+        for (size_t t = diag_[r] + 1; t < offsets_[r + 1]; ++t)
+          if (pos[cols_[t]] != none)
+            values_[pos[cols_[t]]] -= values_[k] * values_[t];
+      }
+
+      if (values_[diag_[i]] == T()) throw std::domain_error("zero pivot");
+
+      for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k)
+        pos[cols_[k]] = none;
+    }
+  }
+};
+
+// Kernels of the solvers below, not part of the interface
+namespace detail {
+
+/**
+ * Compute the dot product x * y.
+ * @brief Solver dot product kernel
+ * @param  n       Size of the vectors
+ * @param  x       First vector
+ * @param  y       Second vector
+ * @param  threads Number of threads
+ * @return Dot product
+ */
+template <typename T>
+T dot(size_t n, const T* x, const T* y, int threads) {
+  const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+  T sum = T();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) \
+    schedule(static) reduction(+ : sum)
+#endif
+  for (ptrdiff_t i = 0; i < size; ++i) sum += x[i] * y[i];
+
+  return sum;
+}
+
+/**
+ * Compute z = x + beta * y, z may be x or y.
+ * @brief Solver vector update kernel
+ * @param n       Size of the vectors
+ * @param x       First vector
+ * @param beta    Scale of y
+ * @param y       Scaled vector
+ * @param z       Output vector
+ * @param threads Number of threads
+ */
+template <typename T>
+void xpby(size_t n, const T* x, const T& beta, const T* y, T* z, int threads) {
+  const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+  for (ptrdiff_t i = 0; i < size; ++i) z[i] = x[i] + beta * y[i];
+}
+
+/**
+ * Compute z = x + beta * y and return z * z in the same pass.
+ * @brief Solver fused vector update and squared norm kernel
+ * @param  n       Size of the vectors
+ * @param  x       First vector
+ * @param  beta    Scale of y
+ * @param  y       Scaled vector
+ * @param  z       Output vector, may be x or y
+ * @param  threads Number of threads
+ * @return Squared norm of z
+ */
+template <typename T>
+T xpby_norm2(size_t n, const T* x, const T& beta, const T* y, T* z,
+             int threads) {
+  const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+  T sum = T();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) \
+    schedule(static) reduction(+ : sum)
+#endif
+  for (ptrdiff_t i = 0; i < size; ++i) {
+    z[i] = x[i] + beta * y[i];
+    sum += z[i] * z[i];
+  }
+
+  return sum;
+}
+
+/**
+ * Compute x += alpha * d and r -= alpha * q, and return r * r, in a single
+ * pass: the Conjugate Gradient update of solution and residual.
+ * @brief Solver fused double axpy and squared norm kernel
+ * @param  n       Size of the vectors
+ * @param  alpha   Step length
+ * @param  d       Search direction
+ * @param  q       A times the search direction
+ * @param  x       Updated solution
+ * @param  r       Updated residual
+ * @param  threads Number of threads
+ * @return Squared norm of the updated r
+ */
+template <typename T>
+T axpy2_norm2(size_t n, const T& alpha, const T* d, const T* q, T* x, T* r,
+              int threads) {
+  const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+  T sum = T();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) \
+    schedule(static) reduction(+ : sum)
+#endif
+  for (ptrdiff_t i = 0; i < size; ++i) {
+    x[i] += alpha * d[i];
+    r[i] -= alpha * q[i];
+    sum += r[i] * r[i];
+  }
+
+  return sum;
+}
+
+/**
+ * Compute d = r + beta * (d - omega * v), the BiCGSTAB search direction.
+ * @brief Solver BiCGSTAB direction kernel
+ * @param n       Size of the vectors
+ * @param r       Residual
+ * @param beta    Scale of the previous direction
+ * @param omega   Stabilization step length
+ * @param v       A times the preconditioned previous direction
+ * @param d       Updated direction
+ * @param threads Number of threads
+ */
+template <typename T>
+void bicgstab_direction(size_t n, const T* r, const T& beta, const T& omega,
+                        const T* v, T* d, int threads) {
+  const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) schedule(static)
+#endif
+  for (ptrdiff_t i = 0; i < size; ++i)
+    d[i] = r[i] + beta * (d[i] - omega * v[i]);
+}
+
+/**
+ * Compute x += alpha * pd + omega * ps and r = s - omega * t, and return
+ * r * r, in a single pass: the BiCGSTAB update of solution and residual.
+ * @brief Solver BiCGSTAB update kernel
+ * @param  n       Size of the vectors
+ * @param  alpha   Step length
+ * @param  pd      Preconditioned search direction
+ * @param  omega   Stabilization step length
+ * @param  ps      Preconditioned intermediate residual
+ * @param  s       Intermediate residual
+ * @param  t       A times ps
+ * @param  x       Updated solution
+ * @param  r       Updated residual
+ * @param  threads Number of threads
+ * @return Squared norm of the updated r
+ */
+template <typename T>
+T bicgstab_update(size_t n, const T& alpha, const T* pd, const T& omega,
+                  const T* ps, const T* s, const T* t, T* x, T* r,
+                  int threads) {
+  const ptrdiff_t size = static_cast<ptrdiff_t>(n);
+  T sum = T();
+
+#ifdef _OPENMP
+#pragma omp parallel for num_threads(threads) if (threads > 1) \
+    schedule(static) reduction(+ : sum)
+#endif
+  for (ptrdiff_t i = 0; i < size; ++i) {
+    x[i] += alpha * pd[i] + omega * ps[i];
+    r[i] = s[i] - omega * t[i];
+    sum += r[i] * r[i];
+  }
+
+  return sum;
+}
+
+/**
+ * Check the sizes of A, b and x, resizing x to zeros when empty.
+ * @brief Helper for the iterative solvers
+ * @param m Square matrix
+ * @param b Right-hand side
+ * @param x Initial guess
+ * @throw out_of_range Matrix is not square, or b and x sizes mismatch
+ */
+template <typename M, typename T>
+void check_system(const M& m, const std::vector<T>& b, std::vector<T>& x) {
+  if (m.rows() != m.cols()) throw std::out_of_range("m.rows() != m.cols()");
+
+  if (b.size() != m.rows()) throw std::out_of_range("b.size() != m.rows()");
+
+  if (x.empty()) x.resize(b.size(), T());
+
+  if (x.size() != m.cols()) throw std::out_of_range("x.size() != m.cols()");
+}
+
+}  // namespace detail
+
+/**
+ * Solve A * x = b, with A symmetric positive definite, using the
+ * preconditioned Conjugate Gradient method.
+ * @brief Conjugate Gradient solver
+ * @param  m        Square matrix A
+ * @param  b        Right-hand side
+ * @param  x        Initial guess (zeros if empty), overwritten with solution
+ * @param  p        Preconditioner, providing apply(r, z, n, threads)
+ * @param  options  Tolerance, iteration limit and threads
+ * @param  callback Called with iteration and residual, false stops the solver
+ * @return Convergence data
+ * @throw  out_of_range Matrix is not square, or b and x sizes mismatch
+ */
+template <typename T, typename I, typename P, typename C>
+solver_result conjugate_gradient(const CompressedSparseMatrix<T, I>& m,
+                                 const std::vector<T>& b, std::vector<T>& x,
+                                 const P& p, const solver_options& options,
+                                 C callback) {
+  detail::check_system(m, b, x);
+
+  const size_t n = b.size();
+  const int threads = options.threads;
+  solver_result result;
+
+  if (n == 0) {
+    result.converged = true;
+    return result;
+  }
+
+  std::vector<T> r(n), z(n), d(n), q(n);
+
+  // r = b - A * x
+  m.multiply(&x[0], &q[0], threads);
+  detail::xpby(n, &b[0], T(-1), &q[0], &r[0], threads);
+
+  T bb = detail::dot(n, &b[0], &b[0], threads);
+  double norm_b = std::sqrt(static_cast<double>(bb));
+  if (norm_b == 0) norm_b = 1;
+
+  T rr0 = detail::dot(n, &r[0], &r[0], threads);
+  double residual = std::sqrt(static_cast<double>(rr0)) / norm_b;
+
+  p.apply(&r[0], &z[0], n, threads);
+  d = z;
+  T rz = detail::dot(n, &r[0], &z[0], threads);
+
+  while (residual > options.tolerance &&
+         result.iterations < options.max_iterations) {
+    // q = A * d, alpha = (r * z) / (d * A * d)
+    T alpha = rz / m.multiply_dot(&d[0], &q[0], &d[0], threads);
+
+    T rr = detail::axpy2_norm2(n, alpha, &d[0], &q[0], &x[0], &r[0], threads);
+    residual = std::sqrt(static_cast<double>(rr)) / norm_b;
+
+    ++result.iterations;
+
+    if (!callback(result.iterations, residual)) break;
+
+    p.apply(&r[0], &z[0], n, threads);
+    T rz_next = detail::dot(n, &r[0], &z[0], threads);
+    T beta = rz_next / rz;
+    rz = rz_next;
+
+    detail::xpby(n, &z[0], beta, &d[0], &d[0], threads);
+  }
+
+  result.residual = residual;
+  result.converged = residual <= options.tolerance;
+
+  return result;
+}
+
+/**
+ * Solve A * x = b using the preconditioned Conjugate Gradient method.
+ * @brief Conjugate Gradient solver
+ * @param  m       Square matrix A
+ * @param  b       Right-hand side
+ * @param  x       Initial guess (zeros if empty), overwritten with solution
+ * @param  p       Preconditioner, providing apply(r, z, n, threads)
+ * @param  options Tolerance, iteration limit and threads
+ * @return Convergence data
+ */
+template <typename T, typename I, typename P>
+solver_result conjugate_gradient(const CompressedSparseMatrix<T, I>& m,
+                                 const std::vector<T>& b, std::vector<T>& x,
+                                 const P& p,
+                                 const solver_options& options =
+                                     solver_options()) {
+  return conjugate_gradient(m, b, x, p, options, no_callback());
+}
+
+/**
+ * Solve A * x = b using the unpreconditioned Conjugate Gradient method.
+ * @brief Conjugate Gradient solver
+ * @param  m       Square matrix A, compressed once before iterating
+ * @param  b       Right-hand side
+ * @param  x       Initial guess (zeros if empty), overwritten with solution
+ * @param  options Tolerance, iteration limit and threads
+ * @return Convergence data
+ */
+template <typename T>
+solver_result conjugate_gradient(const SparseMatrix<T>& m,
+                                 const std::vector<T>& b, std::vector<T>& x,
+                                 const solver_options& options =
+                                     solver_options()) {
+  CompressedSparseMatrix<T, size_t> c(m);
+
+  return conjugate_gradient(c, b, x, IdentityPreconditioner<T>(), options,
+                            no_callback());
+}
+
+/**
+ * Solve A * x = b, with A a generic square matrix, using the right
+ * preconditioned BiCGSTAB method.
+ * @brief BiCGSTAB solver
+ * @param  m        Square matrix A
+ * @param  b        Right-hand side
+ * @param  x        Initial guess (zeros if empty), overwritten with solution
+ * @param  p        Preconditioner, providing apply(r, z, n, threads)
+ * @param  options  Tolerance, iteration limit and threads
+ * @param  callback Called with iteration and residual, false stops the solver
+ * @return Convergence data
+ * @throw  out_of_range Matrix is not square, or b and x sizes mismatch
+ */
+template <typename T, typename I, typename P, typename C>
+solver_result bicgstab(const CompressedSparseMatrix<T, I>& m,
+                       const std::vector<T>& b, std::vector<T>& x, const P& p,
+                       const solver_options& options, C callback) {
+  detail::check_system(m, b, x);
+
+  const size_t n = b.size();
+  const int threads = options.threads;
+  solver_result result;
+
+  if (n == 0) {
+    result.converged = true;
+    return result;
+  }
+
+  std::vector<T> r(n), r0(n), d(n, T()), v(n, T()), s(n), t(n), pd(n), ps(n);
+
+  // r = b - A * x
+  m.multiply(&x[0], &t[0], threads);
+  detail::xpby(n, &b[0], T(-1), &t[0], &r[0], threads);
+  r0 = r;
+
+  T bb = detail::dot(n, &b[0], &b[0], threads);
+  double norm_b = std::sqrt(static_cast<double>(bb));
+  if (norm_b == 0) norm_b = 1;
+
+  T rr0 = detail::dot(n, &r[0], &r[0], threads);
+  double residual = std::sqrt(static_cast<double>(rr0)) / norm_b;
+
+  T rho = T(1), alpha = T(1), omega = T(1);
+
+  while (residual > options.tolerance &&
+         result.iterations < options.max_iterations) {
+    T rho_next = detail::dot(n, &r0[0], &r[0], threads);
+
+    // breakdown, r became orthogonal to r0
+    if (rho_next == T()) break;
+
+    T beta = (rho_next / rho) * (alpha / omega);
+    rho = rho_next;
+
+    detail::bicgstab_direction(n, &r[0], beta, omega, &v[0], &d[0], threads);
+
+    // v = A * M^-1 * d, alpha = rho / (r0 * v)
+    p.apply(&d[0], &pd[0], n, threads);
+    alpha = rho / m.multiply_dot(&pd[0], &v[0], &r0[0], threads);
+
+    T ss = detail::xpby_norm2(n, &r[0], -alpha, &v[0], &s[0], threads);
+
+    ++result.iterations;
+
+    if (std::sqrt(static_cast<double>(ss)) / norm_b <= options.tolerance) {
+      detail::xpby(n, &x[0], alpha, &pd[0], &x[0], threads);
+
+      residual = std::sqrt(static_cast<double>(ss)) / norm_b;
+      callback(result.iterations, residual);
+      break;
+    }
+
+    // t = A * M^-1 * s, omega = (t * s) / (t * t)
+    p.apply(&s[0], &ps[0], n, threads);
+    T ts = m.multiply_dot(&ps[0], &t[0], &s[0], threads);
+    T tt = detail::dot(n, &t[0], &t[0], threads);
+
+    if (tt == T()) break;
+
+    omega = ts / tt;
+
+    T rr = detail::bicgstab_update(n, alpha, &pd[0], omega, &ps[0], &s[0],
+                                   &t[0], &x[0], &r[0], threads);
+    residual = std::sqrt(static_cast<double>(rr)) / norm_b;
+
+    if (!callback(result.iterations, residual)) break;
+
+    if (omega == T()) break;
+  }
+
+  result.residual = residual;
+  result.converged = residual <= options.tolerance;
+
+  return result;
+}
+
+/**
+ * Solve A * x = b using the right preconditioned BiCGSTAB method.
+ * @brief BiCGSTAB solver
+ * @param  m       Square matrix A
+ * @param  b       Right-hand side
+ * @param  x       Initial guess (zeros if empty), overwritten with solution
+ * @param  p       Preconditioner, providing apply(r, z, n, threads)
+ * @param  options Tolerance, iteration limit and threads
+ * @return Convergence data
+ */
+template <typename T, typename I, typename P>
+solver_result bicgstab(const CompressedSparseMatrix<T, I>& m,
+                       const std::vector<T>& b, std::vector<T>& x, const P& p,
+                       const solver_options& options = solver_options()) {
+  return bicgstab(m, b, x, p, options, no_callback());
+}
+
+/**
+ * Solve A * x = b using the unpreconditioned BiCGSTAB method.
+ * @brief BiCGSTAB solver
+ * @param  m       Square matrix A, compressed once before iterating
+ * @param  b       Right-hand side
+ * @param  x       Initial guess (zeros if empty), overwritten with solution
+ * @param  options Tolerance, iteration limit and threads
+ * @return Convergence data
+ */
+template <typename T>
+solver_result bicgstab(const SparseMatrix<T>& m, const std::vector<T>& b,
+                       std::vector<T>& x,
+                       const solver_options& options = solver_options()) {
+  CompressedSparseMatrix<T, size_t> c(m);
+
+  return bicgstab(c, b, x, IdentityPreconditioner<T>(), options,
+                  no_callback());
+}
+
+#endif
@@ -1,13 +1,14 @@
 #ifndef SPARSE_MATRIX_H_
 #define SPARSE_MATRIX_H_
 
-#include <algorithm>  // std::swap
+#include <algorithm>  // std::sort, std::swap
 #include <cassert>    // assert
 #include <cstddef>    // std::ptrdiff_t
 #include <iostream>   // std::ostream
 #include <iterator>   // std::forward_iterator_tag
 #include <new>        // std::bad_alloc
-#include <stdexcept>  // std::out_of_range
+#include <stdexcept>  // std::out_of_range, std::invalid_argument
+#include <vector>     // std::vector
 
 /**
  * Only the elements explicitly inserted (by the user) are physically stored.
@@ -142,6 +143,144 @@ class SparseMatrix {
     }
   }
 
+  /**
+   * Check that p holds each index in [0, n) once and return its inverse.
+   * @brief Helper for function permute
+   * @param  p Permutation
+   * @param  n Expected size of the permutation
+   * @return Inverse permutation
+   * @throw  invalid_argument p is not a permutation of [0, n)
+   */
+  static std::vector<size_t> invert(const std::vector<size_t>& p, size_t n) {
+    const size_t none = static_cast<size_t>(-1);
+    std::vector<size_t> inverse(n, none);
+
+    if (p.size() != n) throw std::invalid_argument("p is not a permutation");
+
+    for (size_t k = 0; k < n; ++k) {
+      if (p[k] >= n || inverse[p[k]] != none)
+        throw std::invalid_argument("p is not a permutation");
+
+      inverse[p[k]] = k;
+    }
+
+    return inverse;
+  }
+
+  /**
+   * Row by row (Gustavson) product over a semiring: row i of the result
+   * combines the rows of other selected by row i of *this into a dense
+   * accumulator. The mask row is marked first, so masked-out products are
+   * skipped before being computed, and rows with an empty (not complemented)
+   * mask row are not visited at all.
+   * @brief Helper for function multiply
+   * @param  other      Other matrix
+   * @param  semiring   Semiring providing zero, add and multiply
+   * @param  mask       Mask matrix, or 0 for no mask
+   * @param  complement Compute only the entries the mask does not store
+   * @return Matrix representing the matrix multiplication
+   * @throw  out_of_range Matrix or mask sizes do not match
+   */
+  template <typename Q, typename S, typename M>
+  SparseMatrix product(const SparseMatrix<Q>& other, const S& semiring,
+                       const SparseMatrix<M>* mask, bool complement) const {
+    if (cols_ != other.rows())
+      throw std::out_of_range("m1.cols() != m2.rows()");
+
+    if (mask && (mask->rows() != rows_ || mask->cols() != other.cols()))
+      throw std::out_of_range("mask size != m1.rows() x m2.cols()");
+
+    const size_t cols = other.cols();
+    const size_t none = static_cast<size_t>(-1);
+
+    // rows of other: the list is sorted, so a prefix sum of counts suffices
+    std::vector<size_t> offsets(other.rows() + 1, 0), columns(other.size());
+    std::vector<T> values(other.size());
+    typename SparseMatrix<Q>::const_iterator b_it;
+    size_t k = 0;
+
+    for (b_it = other.begin(); b_it != other.end(); ++b_it, ++k) {
+      ++offsets[b_it->i + 1];
+      columns[k] = b_it->j;
+      values[k] = static_cast<T>(b_it->value);
+    }
+
+    for (size_t r = 0; r < other.rows(); ++r) offsets[r + 1] += offsets[r];
+
+    // marked[j] == i: accumulator[j] holds row i, masked[j] == i: mask stores
+    // element (i, j)
+    std::vector<T> accumulator(cols);
+    std::vector<size_t> marked(cols, none), masked(mask ? cols : 0, none);
+    std::vector<size_t> touched;
+
+    typename SparseMatrix<M>::const_iterator m_it, m_end;
+
+    if (mask) {
+      m_it = mask->begin();
+      m_end = mask->end();
+    }
+
+    SparseMatrix result(semiring.zero());
+    result.rows_ = rows_;
+    result.cols_ = cols;
+
+    // append in order, result's destructor releases the list on bad_alloc
+    node** tail = &result.head_;
+    const node* n = head_;
+
+    while (n) {
+      const size_t i = n->key.i;
+      bool empty = true;
+
+      if (mask) {
+        while (m_it != m_end && m_it->i < i) ++m_it;
+
+        for (; m_it != m_end && m_it->i == i; ++m_it) {
+          masked[m_it->j] = i;
+          empty = false;
+        }
+
+        if (empty && !complement) {
+          while (n && n->key.i == i) n = n->next;
+
+          continue;
+        }
+      }
+
+      for (; n && n->key.i == i; n = n->next) {
+        const T& a = n->key.value;
+        const size_t r = n->key.j;
+
+        for (k = offsets[r]; k < offsets[r + 1]; ++k) {
+          const size_t j = columns[k];
+
+          if (mask && (masked[j] == i) == complement) continue;
+
+          if (marked[j] != i) {
+            marked[j] = i;
+            accumulator[j] = semiring.multiply(a, values[k]);
+            touched.push_back(j);
+          } else {
+            accumulator[j] =
+                semiring.add(accumulator[j], semiring.multiply(a, values[k]));
+          }
+        }
+      }
+
+      std::sort(touched.begin(), touched.end());
+
+      for (size_t t = 0; t < touched.size(); ++t) {
+        *tail = new node(element(i, touched[t], accumulator[touched[t]]));
+        tail = &(*tail)->next;
+        ++result.size_;
+      }
+
+      touched.clear();
+    }
+
+    return result;
+  }
+
   /**
    * Return the element at the given coordinates.
    * @brief Matrix get element
@@ -454,6 +593,123 @@ class SparseMatrix {
     return result;
   }
 
+  /**
+   * Perform matrix multiplication between *this and other of generic type Q,
+   * with add and multiply given by a semiring (see semiring.h), in
+   * O(rows + cols + products) plus sorting each row. Only stored elements take
+   * part: the result's D is semiring.zero() and the D of the operands is
+   * ignored.
+   * @brief Semiring matrix multiplication
+   * @param  other    Other matrix
+   * @param  semiring Semiring providing zero, add and multiply
+   * @return Matrix representing the matrix multiplication
+   * @throw  out_of_range Matrix sizes do not match
+   */
+  template <typename Q, typename S>
+  SparseMatrix multiply(const SparseMatrix<Q>& other,
+                        const S& semiring) const {
+#ifndef NDEBUG
+    std::cout << "SparseMatrix SparseMatrix::multiply("
+                 "const SparseMatrix<Q>&, const S&) const"
+              << std::endl;
+#endif
+
+    const SparseMatrix* mask = 0;
+
+    return product(other, semiring, mask, false);
+  }
+
+  /**
+   * Perform masked matrix multiplication: only the entries stored in mask
+   * (its structure, whatever the values) are computed, or with complement
+   * only the entries it does not store.
+   * @brief Masked semiring matrix multiplication
+   * @param  other      Other matrix
+   * @param  semiring   Semiring providing zero, add and multiply
+   * @param  mask       Mask matrix, rows() x other.cols()
+   * @param  complement Use the complement of the mask (default: false)
+   * @return Matrix representing the matrix multiplication
+   * @throw  out_of_range Matrix or mask sizes do not match
+   */
+  template <typename Q, typename S, typename M>
+  SparseMatrix multiply(const SparseMatrix<Q>& other, const S& semiring,
+                        const SparseMatrix<M>& mask,
+                        bool complement = false) const {
+#ifndef NDEBUG
+    std::cout << "SparseMatrix SparseMatrix::multiply(const SparseMatrix<Q>&, "
+                 "const S&, const SparseMatrix<M>&, bool) const"
+              << std::endl;
+#endif
+
+    return product(other, semiring, &mask, complement);
+  }
+
+  /**
+   * Return the matrix B with B(i, j) = A(p[i], q[j]). Stored elements are
+   * sorted by their new coordinates with two counting sorts, so the list is
+   * built in O(size + rows + cols) instead of inserting each element.
+   * @brief Matrix permutation
+   * @param  p Row permutation, rows() indices
+   * @param  q Column permutation, cols() indices
+   * @return Permuted matrix
+   * @throw  invalid_argument p or q is not a permutation
+   */
+  SparseMatrix permute(const std::vector<size_t>& p,
+                       const std::vector<size_t>& q) const {
+#ifndef NDEBUG
+    std::cout << "SparseMatrix SparseMatrix::permute("
+                 "const std::vector<size_t>&, const std::vector<size_t>&) const"
+              << std::endl;
+#endif
+
+    std::vector<size_t> p_inv = invert(p, rows_);
+    std::vector<size_t> q_inv = invert(q, cols_);
+
+    std::vector<const node*> nodes(size_);
+    std::vector<size_t> rows(size_), cols(size_), by_col(size_), by_row(size_);
+    std::vector<size_t> next(cols_ + 1, 0);
+    size_t k = 0;
+
+    for (const node* n = head_; n; n = n->next, ++k) {
+      nodes[k] = n;
+      rows[k] = p_inv[n->key.i];
+      cols[k] = q_inv[n->key.j];
+      ++next[cols[k] + 1];
+    }
+
+    // sort by new column, then stable sort by new row
+    for (size_t j = 0; j < cols_; ++j) next[j + 1] += next[j];
+
+    for (k = 0; k < size_; ++k) by_col[next[cols[k]]++] = k;
+
+    next.assign(rows_ + 1, 0);
+
+    for (k = 0; k < size_; ++k) ++next[rows[k] + 1];
+
+    for (size_t i = 0; i < rows_; ++i) next[i + 1] += next[i];
+
+    for (size_t t = 0; t < size_; ++t) {
+      k = by_col[t];
+      by_row[next[rows[k]]++] = k;
+    }
+
+    SparseMatrix result(D_);
+    result.rows_ = rows_;
+    result.cols_ = cols_;
+
+    // append in order, result's destructor releases the list on bad_alloc
+    node** tail = &result.head_;
+
+    for (size_t t = 0; t < size_; ++t) {
+      k = by_row[t];
+      *tail = new node(element(rows[k], cols[k], nodes[k]->key.value));
+      tail = &(*tail)->next;
+      ++result.size_;
+    }
+
+    return result;
+  }
+
   /**
    * Clear the Matrix.
    * @brief Matrix clear
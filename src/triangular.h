@@ -0,0 +1,214 @@
+#ifndef TRIANGULAR_H_
+#define TRIANGULAR_H_
+
+#include <cstddef>    // std::ptrdiff_t
+#include <stdexcept>  // std::domain_error, std::invalid_argument
+#include <vector>     // std::vector
+
+#include "sparsematrix.h"
+
+// Helpers of the triangular solves, not part of the interface
+namespace detail {
+
+/**
+ * Group the rows of a triangular matrix in dependency levels: each row gets
+ * the level following its latest dependency, then rows are sorted by level,
+ * so that rows of the same level can be solved in parallel.
+ * @brief Level schedule of a triangular solve
+ * @param n      Matrix rows
+ * @param lower  Rows depend on previous (true) or following (false) rows
+ * @param first  Dependencies of row i are cols[first[i]] to cols[last[i] - 1]
+ * @param last   End of the dependencies of each row
+ * @param cols   Column indices
+ * @param order  Rows sorted by level
+ * @param levels Level l is [levels[l], [l + 1]) of order
+ */
+inline void level_schedule(size_t n, bool lower, const size_t* first,
+                           const size_t* last, const size_t* cols,
+                           std::vector<size_t>& order,
+                           std::vector<size_t>& levels) {
+  std::vector<size_t> level(n, 0);
+  size_t count = 0;
+
+  for (size_t r = 0; r < n; ++r) {
+    size_t i = lower ? r : n - 1 - r;
+
+    for (size_t k = first[i]; k < last[i]; ++k)
+      if (level[cols[k]] + 1 > level[i]) level[i] = level[cols[k]] + 1;
+
+    if (level[i] + 1 > count) count = level[i] + 1;
+  }
+
+  // counting sort of the rows by level
+  levels.assign(count + 1, 0);
+  order.resize(n);
+
+  for (size_t i = 0; i < n; ++i) ++levels[level[i] + 1];
+
+  for (size_t l = 0; l < count; ++l) levels[l + 1] += levels[l];
+
+  std::vector<size_t> next(levels.begin(), levels.end() - 1);
+
+  for (size_t i = 0; i < n; ++i) order[next[level[i]]++] = i;
+}
+
+}  // namespace detail
+
+/**
+ * Solves L * x = b or U * x = b, taking the lower or upper triangle of a
+ * square matrix whose unstored elements are zero (elements of the other
+ * triangle are ignored). The constructor groups rows in dependency levels:
+ * rows of the same level only depend on rows of previous levels, so they are
+ * solved in parallel. The analysis is reused by every call to solve.
+ * @brief Sparse triangular solver templated class
+ */
+template <typename T>
+class TriangularSolver {
+ public:
+  /**
+   * Copy a triangle of the matrix and build its level schedule, visiting the
+   * list only once.
+   * @brief Triangular solver constructor
+   * @param m             Square matrix
+   * @param lower         Solve with the lower (true) or upper (false) triangle
+   * @param unit_diagonal Diagonal is implicitly one (default: false)
+   * @throw out_of_range     Matrix is not square
+   * @throw invalid_argument Unstored elements are not zero
+   * @throw domain_error     A diagonal element is zero or missing
+   */
+  TriangularSolver(const SparseMatrix<T>& m, bool lower,
+                   bool unit_diagonal = false)
+      : n_(m.rows()),
+        lower_(lower),
+        offsets_(m.rows() + 1, 0),
+        inverse_(m.rows(), T(1)) {
+    if (m.rows() != m.cols()) throw std::out_of_range("m.rows() != m.cols()");
+    if (m.D() != T()) throw std::invalid_argument("m.D() != 0");
+
+    std::vector<bool> has_diag(n_, unit_diagonal);
+    typename SparseMatrix<T>::const_iterator it;
+
+    for (it = m.begin(); it != m.end(); ++it) {
+      if (it->i == it->j) {
+        if (unit_diagonal) continue;
+
+        if (it->value == T()) throw std::domain_error("zero diagonal element");
+
+        inverse_[it->i] = T(1) / it->value;
+        has_diag[it->i] = true;
+      } else if ((it->j < it->i) == lower) {
+        cols_.push_back(it->j);
+        values_.push_back(it->value);
+        ++offsets_[it->i + 1];
+      }
+    }
+
+    for (size_t i = 0; i < n_; ++i) {
+      if (!has_diag[i]) throw std::domain_error("missing diagonal element");
+
+      offsets_[i + 1] += offsets_[i];
+    }
+
+    detail::level_schedule(n_, lower_, &offsets_[0], &offsets_[0] + 1,
+                           cols_.empty() ? 0 : &cols_[0], order_, levels_);
+  }
+
+  /**
+   * Get the number of dependency levels, the sequential steps of solve.
+   * @brief Levels getter
+   * @return Number of levels
+   */
+  size_t levels() const { return levels_.empty() ? 0 : levels_.size() - 1; }
+
+  /**
+   * Solve the triangular system, one level at a time.
+   * @brief Triangular solve
+   * @param b       Right-hand side, n values
+   * @param x       Solution, n values (may alias b)
+   * @param threads Number of threads (default: 1)
+   */
+  void solve(const T* b, T* x, int threads = 1) const {
+    const ptrdiff_t levels = static_cast<ptrdiff_t>(this->levels());
+
+#ifdef _OPENMP
+#pragma omp parallel num_threads(threads) if (threads > 1)
+#endif
+    for (ptrdiff_t l = 0; l < levels; ++l) {
+      const ptrdiff_t first = static_cast<ptrdiff_t>(levels_[l]);
+      const ptrdiff_t last = static_cast<ptrdiff_t>(levels_[l + 1]);
+
+#ifdef _OPENMP
+#pragma omp for schedule(static)
+#endif
+      for (ptrdiff_t r = first; r < last; ++r) {
+        size_t i = order_[r];
+        T sum = b[i];
+
+        for (size_t k = offsets_[i]; k < offsets_[i + 1]; ++k)
+          sum -= values_[k] * x[cols_[k]];
+
+        x[i] = sum * inverse_[i];
+      }
+    }
+  }
+
+  /**
+   * Solve the triangular system and return the solution.
+   * @brief Triangular solve
+   * @param  b       Right-hand side
+   * @param  threads Number of threads (default: 1)
+   * @return Solution vector
+   * @throw  out_of_range b size differs from matrix rows
+   */
+  std::vector<T> solve(const std::vector<T>& b, int threads = 1) const {
+    if (b.size() != n_) throw std::out_of_range("b.size() != m.rows()");
+
+    std::vector<T> x(b);
+
+    if (n_ > 0) solve(&x[0], &x[0], threads);
+
+    return x;
+  }
+
+ private:
+  size_t n_;    ///< Matrix rows
+  bool lower_;  ///< Lower or upper triangle
+
+  std::vector<size_t> offsets_;  ///< Row i is stored in [offsets_[i], [i + 1])
+  std::vector<size_t> cols_;     ///< Column indices, diagonal excluded
+  std::vector<T> values_;        ///< Values, diagonal excluded
+  std::vector<T> inverse_;       ///< Inverse of the diagonal elements
+
+  std::vector<size_t> order_;   ///< Rows sorted by level
+  std::vector<size_t> levels_;  ///< Level l is [levels_[l], [l + 1]) of order_
+};
+
+/**
+ * Solve L * x = b with the lower triangle of m.
+ * @brief Lower triangular solve
+ * @param  m Square matrix, unstored elements zero
+ * @param  b Right-hand side
+ * @return Solution vector
+ * @throw  invalid_argument Unstored elements are not zero
+ * @throw  domain_error     A diagonal element is zero or missing
+ */
+template <typename T>
+std::vector<T> solve_lower(const SparseMatrix<T>& m, const std::vector<T>& b) {
+  return TriangularSolver<T>(m, true).solve(b);
+}
+
+/**
+ * Solve U * x = b with the upper triangle of m.
+ * @brief Upper triangular solve
+ * @param  m Square matrix, unstored elements zero
+ * @param  b Right-hand side
+ * @return Solution vector
+ * @throw  invalid_argument Unstored elements are not zero
+ * @throw  domain_error     A diagonal element is zero or missing
+ */
+template <typename T>
+std::vector<T> solve_upper(const SparseMatrix<T>& m, const std::vector<T>& b) {
+  return TriangularSolver<T>(m, false).solve(b);
+}
+
+#endif